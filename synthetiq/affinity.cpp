@@ -0,0 +1,170 @@
+#include "affinity.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <pthread.h>
+#include <sched.h>
+
+/**
+ * @brief Reads the CPUs the calling thread may run on.
+ *
+ * @return The CPUs of the thread.
+ */
+static cpu_set_t readProcessCpus() {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    sched_getaffinity(0, sizeof(cpus), &cpus);
+    return cpus;
+}
+
+/**
+ * @brief Constructs a ThreadPlacement from a placement policy. Only the CPUs the process may run on are used by "compact" and "scatter".
+ *
+ * @param policy "none", "compact", "scatter" or a CPU list.
+ * @throws std::invalid_argument If the policy is not one of these, or if the CPU list is malformed.
+ */
+ThreadPlacement::ThreadPlacement(std::string policy) : policy(policy) {
+    processCpus();
+    if (policy == "none") {
+        return;
+    }
+    std::map<int, std::vector<int>> node_cpus;
+    if (std::filesystem::is_directory("/sys/devices/system/node")) {
+        for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator("/sys/devices/system/node")) {
+            std::string name = entry.path().filename().string();
+            if (name.rfind("node", 0) != 0 || name.size() == 4 || name.find_first_not_of("0123456789", 4) != std::string::npos) {
+                continue;
+            }
+            std::ifstream file(entry.path() / "cpulist");
+            std::string list;
+            if (std::getline(file, list) && !list.empty()) {
+                node_cpus[std::stoi(name.substr(4))] = parseCpuList(list);
+            }
+        }
+    }
+    cpu_set_t allowed = processCpus();
+    if (node_cpus.empty()) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, &allowed)) {
+                node_cpus[0].push_back(cpu);
+            }
+        }
+    }
+    // nodes are numbered in the order of their ids, which need not be contiguous
+    int node = 0;
+    std::vector<std::vector<int>> allowed_cpus;
+    for (std::pair<const int, std::vector<int>>& cpus_of_node : node_cpus) {
+        allowed_cpus.push_back({});
+        for (int cpu : cpus_of_node.second) {
+            cpu_nodes[cpu] = node;
+            if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)) {
+                allowed_cpus.back().push_back(cpu);
+            }
+        }
+        node++;
+    }
+    n_nodes = node;
+
+    if (policy == "compact") {
+        for (std::vector<int>& node_allowed : allowed_cpus) {
+            cpus.insert(cpus.end(), node_allowed.begin(), node_allowed.end());
+        }
+    } else if (policy == "scatter") {
+        bool added = true;
+        for (int index = 0; added; index++) {
+            added = false;
+            for (std::vector<int>& node_allowed : allowed_cpus) {
+                if (index < node_allowed.size()) {
+                    cpus.push_back(node_allowed[index]);
+                    added = true;
+                }
+            }
+        }
+    } else {
+        cpus = parseCpuList(policy);
+    }
+    if (cpus.empty()) {
+        throw std::invalid_argument("No CPU to place threads on with affinity " + policy);
+    }
+}
+
+/**
+ * @brief Returns the CPUs the process may run on, read once before any thread is pinned: the threads pinned by a search can be reused by the
+ * next one, and only know their own CPU.
+ *
+ * @return The CPUs of the process.
+ */
+cpu_set_t ThreadPlacement::processCpus() {
+    static cpu_set_t process_cpus = readProcessCpus();
+    return process_cpus;
+}
+
+/**
+ * @brief Parses a CPU list in the format of sysfs and taskset, e.g. "0-3,8,10-11".
+ *
+ * @param list The CPU list.
+ * @return The CPUs of the list, in its order.
+ * @throws std::invalid_argument If the list is malformed.
+ */
+std::vector<int> ThreadPlacement::parseCpuList(const std::string& list) {
+    std::vector<int> cpus;
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t end = std::min(list.find(',', start), list.size());
+        std::string range = list.substr(start, end - start);
+        size_t dash = range.find('-');
+        if (range.empty() || range.find_first_not_of("0123456789-") != std::string::npos || dash == 0 || dash == range.size() - 1) {
+            throw std::invalid_argument("Invalid CPU list " + list);
+        }
+        int first = std::stoi(range.substr(0, dash));
+        int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+        if (last < first || last >= CPU_SETSIZE) {
+            throw std::invalid_argument("Invalid CPU list " + list);
+        }
+        for (int cpu = first; cpu <= last; cpu++) {
+            cpus.push_back(cpu);
+        }
+        start = end + 1;
+    }
+    return cpus;
+}
+
+/**
+ * @brief Pins the calling thread to the CPU of a thread, or lets it run on all CPUs of the process with "none". Memory the thread touches first afterwards is then allocated on the NUMA node
+ * of the CPU, so the thread must be pinned before it builds its state.
+ *
+ * @param thread The index of the thread.
+ * @return False if the thread could not be pinned, e.g. because the CPU does not exist. The thread then runs where the scheduler puts it.
+ */
+bool ThreadPlacement::pin(int thread) {
+    cpu_set_t set = processCpus();
+    if (!cpus.empty()) {
+        CPU_ZERO(&set);
+        CPU_SET(cpus[thread % cpus.size()], &set);
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+/**
+ * @brief Returns the NUMA node a thread runs on once pinned.
+ *
+ * @param thread The index of the thread.
+ * @return The index of the node, between 0 and getNNodes() - 1. 0 when threads are not pinned.
+ */
+int ThreadPlacement::nodeOf(int thread) {
+    if (cpus.empty()) {
+        return 0;
+    }
+    std::map<int, int>::iterator node = cpu_nodes.find(cpus[thread % cpus.size()]);
+    return node == cpu_nodes.end() ? 0 : node->second;
+}
+
+/**
+ * @brief Returns the number of NUMA nodes the threads can be on.
+ *
+ * @return The number of nodes, 1 when threads are not pinned.
+ */
+int ThreadPlacement::getNNodes() {
+    return cpus.empty() ? 1 : n_nodes;
+}
@@ -0,0 +1,30 @@
+#ifndef DEF_AFFINITY
+#define DEF_AFFINITY
+
+#include <map>
+#include <sched.h>
+#include <string>
+#include <vector>
+
+class ThreadPlacement {
+    // the CPUs the threads of a search run on. With "none", threads are left to the scheduler. "compact" fills the CPUs of a NUMA node
+    // before the next one, "scatter" alternates between the nodes, and a CPU list such as "0-15,32-47" pins thread i to the i-th CPU of
+    // the list, modulo its length. The NUMA nodes are read from sysfs; a machine without them is a single node. With "none", pin gives the
+    // thread back all CPUs of the process, which a thread reused from an earlier search may have lost.
+    public:
+        ThreadPlacement(std::string policy="none");
+        bool pin(int thread);
+        int nodeOf(int thread);
+        int getNNodes();
+
+    private:
+        static std::vector<int> parseCpuList(const std::string& list);
+        static cpu_set_t processCpus();
+
+        std::string policy;
+        std::vector<int> cpus; // CPU of each thread, modulo the number of CPUs
+        std::map<int, int> cpu_nodes; // NUMA node of each CPU
+        int n_nodes = 1;
+};
+
+#endif
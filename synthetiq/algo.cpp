@@ -2,6 +2,7 @@
 
 #include "circuit.h"
 #include "mcmc_sa.h"
+#include "mcmc_pt.h"
 #include "cost.h"
 #include "randomhelper.h"
 #include "randomCircuit.h"
@@ -18,6 +19,13 @@
 #include <Eigen/Dense>
 #include <filesystem>
 #include <sstream>
+#include <mutex>
+#include <fstream>
+#include <iterator>
+#include <poll.h>
+
+// guards the times files, which the jobs of a batch append to concurrently
+static std::mutex times_file_mutex;
 
 Parser::Parser() {
 
@@ -28,6 +36,7 @@ Parser::Parser() {
  * 
  * @param argc The number of command line arguments.
  * @param argv The array of command line arguments.
+ * @throws std::invalid_argument If the arguments combine options that do not work together.
  */
 void Parser::parse(int argc, char* argv[]) {
     input_name = argv[1];
@@ -100,6 +109,32 @@ void Parser::parse(int argc, char* argv[]) {
             do_resynth = false;
         } else if (std::string(argv[arg]) == "--simple") {
             simple_cost = true;
+        } else if (std::string(argv[arg]) == "--environment-cost") {
+            environment_cost = true;
+        } else if (std::string(argv[arg]) == "--heat-bath") {
+            heat_bath = true;
+        } else if (std::string(argv[arg]) == "--race-permutations") {
+            race_permutations = true;
+        } else if (std::string(argv[arg]) == "--tempering") {
+            tempering_replicas = std::stoi(argv[arg + 1]);
+        } else if (std::string(argv[arg]) == "--tempering-ratio") {
+            tempering_ratio = std::stod(argv[arg + 1]);
+        } else if (std::string(argv[arg]) == "--tempering-continue") {
+            tempering_continue = true;
+        } else if (std::string(argv[arg]) == "--elite") {
+            elite_size = std::stoi(argv[arg + 1]);
+        } else if (std::string(argv[arg]) == "--elite-fraction") {
+            elite_fraction = std::stod(argv[arg + 1]);
+        } else if (std::string(argv[arg]) == "--elite-strength") {
+            elite_strength = std::stod(argv[arg + 1]);
+        } else if (std::string(argv[arg]) == "--elite-temp") {
+            elite_temp = std::stod(argv[arg + 1]);
+        } else if (std::string(argv[arg]) == "--stagnation-window") {
+            stagnation_window = std::stod(argv[arg + 1]);
+        } else if (std::string(argv[arg]) == "--stagnation-improvement") {
+            stagnation_improvement = std::stod(argv[arg + 1]);
+        } else if (std::string(argv[arg]) == "--min-acceptance") {
+            min_acceptance = std::stod(argv[arg + 1]);
         } else if (std::string(argv[arg]) == "--n-norm") {
             n_norm = std::stod(argv[arg + 1]);
         } else if (std::string(argv[arg]) == "--iterations-factor") {
@@ -136,9 +171,20 @@ void Parser::parse(int argc, char* argv[]) {
             base_output_folder = "";
         } else if (std::string(argv[arg]) == "--absolute-gates") {
             base_gate_folder = "";
+        } else if (std::string(argv[arg]) == "--serve") {
+            serve_address = argv[arg + 1];
+        } else if (std::string(argv[arg]) == "--store") {
+            store_folder = argv[arg + 1];
+        } else if (std::string(argv[arg]) == "--affinity") {
+            affinity = argv[arg + 1];
         }
     }
 
+    // the replicas of parallel tempering stay at fixed temperatures, there is no annealing run to stop
+    if (tempering_replicas > 0 && (stagnation_window > 0 || min_acceptance > 0)) {
+        throw std::invalid_argument("--tempering cannot be combined with --stagnation-window or --min-acceptance");
+    }
+
     // print all the parameters
     std::cout << "Input file: " << base_input_folder + input_name << std::endl;
     std::cout << "Output folder: " << base_output_folder + output_folder << std::endl;
@@ -164,6 +210,21 @@ void Parser::parse(int argc, char* argv[]) {
     std::cout << "Enable permutations: " << enable_permutations << std::endl;
     std::cout << "Do resynth: " << do_resynth << std::endl;
     std::cout << "Simple cost: " << simple_cost << std::endl;
+    std::cout << "Environment cost: " << environment_cost << std::endl;
+    std::cout << "Heat bath: " << heat_bath << std::endl;
+    std::cout << "Race permutations: " << race_permutations << std::endl;
+    std::cout << "Tempering replicas: " << tempering_replicas << std::endl;
+    std::cout << "Tempering ratio: " << tempering_ratio << std::endl;
+    std::cout << "Tempering continue: " << tempering_continue << std::endl;
+    std::cout << "Elite size: " << elite_size << std::endl;
+    std::cout << "Elite fraction: " << elite_fraction << std::endl;
+    std::cout << "Elite strength: " << elite_strength << std::endl;
+    std::cout << "Elite temp: " << elite_temp << std::endl;
+    std::cout << "Stagnation window: " << stagnation_window << std::endl;
+    std::cout << "Stagnation improvement: " << stagnation_improvement << std::endl;
+    std::cout << "Min acceptance: " << min_acceptance << std::endl;
+    std::cout << "Store: " << store_folder << std::endl;
+    std::cout << "Affinity: " << affinity << std::endl;
     std::cout << "N norm: " << n_norm << std::endl;
     std::cout << "Iterations factor: " << iterations_factor << std::endl;
     std::cout << "Update gate scheme: " << update_gate_scheme << std::endl;
@@ -202,14 +263,37 @@ void Parser::createOutputFolder() {
 }
 
 /**
- * @brief Constructor for the Algorithm class.
+ * @brief Constructor for the Algorithm class. With "--connect <address>" instead of the input file, the process is a worker of the coordinator
+ * at the address: it takes the specification and the arguments of the coordinator, followed by its own arguments, e.g. its number of threads.
  * 
  * @param argc The number of command-line arguments.
  * @param argv An array of command-line arguments.
+ * @throws std::invalid_argument If the thread placement given by --affinity is invalid.
  */
 Algorithm::Algorithm(int argc, char* argv[]) {
-    parser.parse(argc, argv);
-    parser.createOutputFolder();
+    if (argc > 2 && std::string(argv[1]) == "--connect") {
+        link = std::make_shared<WorkerLink>(argv[2]);
+        std::vector<std::string> args = link->handshake();
+        args.insert(args.begin(), argv[0]);
+        args.insert(args.end(), argv + 3, argv + argc);
+        std::vector<char*> worker_argv;
+        for (std::string& arg : args) {
+            worker_argv.push_back(arg.data());
+        }
+        parser.parse(worker_argv.size(), worker_argv.data());
+        link->setBatchSize(parser.tempering_replicas > 0 ? nbLadders(parser.n_threads) : parser.n_threads);
+    } else {
+        parser.parse(argc, argv);
+        parser.createOutputFolder();
+        for (int arg = 2; arg < argc; arg++) {
+            if (std::string(argv[arg]) == "--serve") {
+                arg++;
+            } else {
+                forwarded_args.push_back(argv[arg]);
+            }
+        }
+    }
+    placement = ThreadPlacement(parser.affinity);
     t1_total = std::chrono::high_resolution_clock::now();
     t2_total = std::chrono::high_resolution_clock::now();
     time_taken_total = 0.0;
@@ -226,6 +310,28 @@ Algorithm::Algorithm() {
     time_taken_total = 0.0;
 }
 
+/**
+ * @brief Returns the time elapsed since the start of the algorithm. Every thread calls it to check the time limit itself.
+ * 
+ * @return The elapsed time in seconds.
+ */
+double Algorithm::elapsedTotal() {
+    std::chrono::time_point<std::chrono::high_resolution_clock> now = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::duration<double, std::ratio<1>>>(now - t1_total).count();
+}
+
+/**
+ * @brief Returns the number of ladders of parallel tempering run at the same time, one for every tempering_replicas threads, so that no thread
+ * waits for replicas to step.
+ *
+ * @param n_threads The number of threads of the run.
+ * @return The number of ladders.
+ */
+int Algorithm::nbLadders(int n_threads) {
+    int n_replicas = std::max(1, parser.tempering_replicas);
+    return std::max(1, (n_threads + n_replicas - 1) / n_replicas);
+}
+
 /**
  * @brief Initializes a shared pointer to a QubitIndependentPartialMatrix object.
  * 
@@ -240,12 +346,12 @@ Algorithm::Algorithm() {
 std::shared_ptr<QubitIndependentPartialMatrix> Algorithm::initMatrix() {
     PartialMatrix original;
     MatrixGenerator matrix_gen = MatrixGenerator();
-    CircuitHelper ch = CircuitHelper(1, parser.base_gate_folder + parser.gate_set, parser.base_gate_folder + parser.composite_gate_folder);
+    std::shared_ptr<CircuitHelper> ch = CircuitHelper::shared(1, parser.base_gate_folder + parser.gate_set, parser.base_gate_folder + parser.composite_gate_folder);
     if (parser.format == "qasm") {
-        GateCircuit circuit_obj = GateCircuit(ch);
+        GateCircuit circuit_obj = GateCircuit(*ch);
         circuit_obj.readFromInput(parser.base_input_folder + parser.input_name);
-        ch = *circuit_obj.getCircuitHelper();
-        original = PartialMatrix(std::ref(circuit_obj), ch);
+        ch = circuit_obj.getCircuitHelper();
+        original = PartialMatrix(std::ref(circuit_obj), *ch);
     } else {
         original = PartialMatrix(parser.base_input_folder + parser.input_name);
     }     
@@ -269,30 +375,71 @@ std::shared_ptr<QubitIndependentPartialMatrix> Algorithm::initMatrix() {
  * @param run The number of times the inner loop has been run so far (used for seeding).
  */
 std::map<std::string, double> Algorithm::run_inner_loop(std::shared_ptr<QubitIndependentPartialMatrix> input_matrix, int run) {
-    bool stop_inner = false;
+    std::atomic<bool> stop_inner(false);
     std::map<std::string, double> output_map;
     output_map["tcount"] = -1;
     output_map["tdepth"] = -1;
     output_map["gatecount"] = -1;
     output_map["cost"] = -1;
-    auto t_start_inner = std::chrono::high_resolution_clock::now();
-    auto t_end_inner = std::chrono::high_resolution_clock::now();
-    double time_taken_inner = std::chrono::duration_cast<std::chrono::duration<double, std::ratio<1>>>(t_end_inner-t_start_inner).count();
-    omp_set_num_threads(parser.n_threads);
-    #pragma omp parallel num_threads(parser.n_threads) 
+    // time of the last circuit found by any thread, the time taken for a circuit is measured from it
+    std::atomic<std::chrono::high_resolution_clock::rep> last_found(std::chrono::high_resolution_clock::now().time_since_epoch().count());
+    // in a batch, the job only starts its share of the cores of the batch, which grows in the next runs as the other jobs finish
+    int n_threads = core_pool ? std::min(parser.n_threads, core_pool->threadsPerJob()) : parser.n_threads;
+    omp_set_num_threads(n_threads);
+    // with parallel tempering, the threads step the replicas of ladders instead of running independent restarts, with a ladder for every
+    // tempering_replicas threads. The threads of a ladder are nested in the thread that runs its restarts
+    int n_restart_threads = parser.tempering_replicas > 0 ? nbLadders(n_threads) : n_threads;
+    if (parser.tempering_replicas > 0) {
+        omp_set_max_active_levels(2);
+    }
+    // each thread only writes its own results, which are merged once all threads are done
+    std::vector<std::map<std::string, double>> thread_outputs(n_restart_threads, output_map);
+    std::vector<std::vector<double>> thread_times(n_restart_threads);
+    // the time budget is a hard bound: the searches in progress stop at the deadline, and once the run is over
+    std::shared_ptr<CancellationToken> cancellation = std::make_shared<CancellationToken>(parser.time_allowed - elapsedTotal());
+    // the simplification of a found circuit only stops at the deadline, not when another thread ends the run early
+    std::shared_ptr<CancellationToken> resynth_deadline = std::make_shared<CancellationToken>(parser.time_allowed - elapsedTotal());
+    if (parser.elite_size > 0 && !elite_pool) {
+        elite_pool = std::make_shared<ElitePool>(parser.elite_size);
+    }
+    // with threads on several NUMA nodes, each node has its own copy of the target matrices, made by its first thread
+    std::vector<std::shared_ptr<QubitIndependentPartialMatrix>> node_matrices(placement.getNNodes());
+    #pragma omp parallel num_threads(n_restart_threads) 
     {   
         int id = omp_get_thread_num();
+        // the thread is pinned before it allocates its state, so that the state is in the memory of its node
+        placement.pin(id);
+        int node = placement.nodeOf(id);
+        std::map<std::string, double>& thread_output = thread_outputs[id];
         RandomHelper random_helper = RandomHelper();
-        random_helper.seed(id + run * parser.n_threads);
+        // the workers of a coordinator have the same thread ids and runs, their index keeps their seeds apart
+        random_helper.seed(id + run * parser.n_threads + (link ? link->getWorkerIndex() << 16 : 0));
         std::shared_ptr<ExactEqualityComputer> exact_comp = std::make_shared<ExactEqualityComputer>(ExactEqualityComputer(parser.epsilon));
         RandomCircuitGen random_gen = RandomCircuitGen(random_helper, parser.pid);
         Resynthesize resynth = Resynthesize(parser.optimization_numb, parser.optimize_depth);
-        std::shared_ptr<QubitIndependentPartialMatrix> matrix = input_matrix->clone();
-        CircuitHelper ch = CircuitHelper(matrix->getNQubits(), parser.base_gate_folder + parser.gate_set, parser.base_gate_folder + parser.composite_gate_folder);
+        resynth.set_cancellation(resynth_deadline);
+        // the target matrices are read-only, so all threads of a node use the same ones
+        std::shared_ptr<QubitIndependentPartialMatrix> matrix = input_matrix;
+        if (node_matrices.size() > 1) {
+            #pragma omp critical(node_matrices)
+            {
+                if (node_matrices[node] == nullptr) {
+                    node_matrices[node] = input_matrix->replicate();
+                }
+                matrix = node_matrices[node];
+            }
+        }
+        // the gate library is built by the first thread of each node and shared by all threads of the node and runs
+        CircuitHelper& ch = *CircuitHelper::shared(matrix->getNQubits(), parser.base_gate_folder + parser.gate_set, parser.base_gate_folder + parser.composite_gate_folder,
+                                                   "data/gates/read_gates", node);
         GatesSumComputer perf_comp = GatesSumComputer();
         MCMC_Sa algo2 = MCMC_Sa(random_helper, parser.pid, parser.iterations_factor * matrix->getNQubits(), parser.enable_permutations);
         ExponentialTemperatureScheme temp_scheme = ExponentialTemperatureScheme(parser.start_temp_base / std::sqrt(pow(2.0, matrix->getNQubits())), parser.n_norm);
-        algo2.set_temp_scheme(std::make_shared<ExponentialTemperatureScheme>(temp_scheme));
+        std::shared_ptr<TemperatureScheme> random_start_scheme = std::make_shared<ExponentialTemperatureScheme>(temp_scheme);
+        // a perturbed elite is already close to a solution, annealing it from the full start temperature would mostly undo it
+        std::shared_ptr<TemperatureScheme> elite_start_scheme = std::make_shared<ExponentialTemperatureScheme>(
+            ExponentialTemperatureScheme(parser.elite_temp * parser.start_temp_base / std::sqrt(pow(2.0, matrix->getNQubits())), parser.n_norm));
+        algo2.set_temp_scheme(random_start_scheme);
         
         if (!parser.simple_cost) {
             std::shared_ptr<FroebeniusCostComputer> froeb = std::make_shared<FroebeniusCostComputer>(FroebeniusCostComputer());
@@ -302,15 +449,90 @@ std::map<std::string, double> Algorithm::run_inner_loop(std::shared_ptr<QubitInd
             algo2.set_eq_comp(froeb);
         }
         algo2.set_exact_eq_comp(exact_comp);
-        Mutator mutator = Mutator(parser.pid, parser.pcomp);
-        algo2.set_mutator(std::make_shared<Mutator>(mutator));
-        while (time_taken_total < parser.time_allowed && n_found_so_far < parser.n_found_stop && !stop_inner) {
+        algo2.set_environment_cost(parser.environment_cost);
+        algo2.set_permutation_racing(parser.race_permutations);
+        algo2.set_stagnation(StagnationDetector(parser.stagnation_window, parser.stagnation_improvement, parser.min_acceptance));
+        algo2.set_cancellation(cancellation);
+        // gates are drawn uniformly instead of by name first (proba_name 0), which is the distribution the search was tuned with
+        if (parser.heat_bath) {
+            algo2.set_mutator(std::make_shared<HeatBathMutator>(HeatBathMutator(parser.pid, parser.pcomp, 0.0)));
+        } else {
+            Mutator mutator = Mutator(parser.pid, parser.pcomp, 0.0);
+            algo2.set_mutator(std::make_shared<Mutator>(mutator));
+        }
+        MCMC* engine = &algo2;
+        std::shared_ptr<MCMC_Pt> tempering;
+        // the threads are divided among the ladders, the first ladders take the remainder
+        int n_ladder_threads = n_threads / n_restart_threads + (id < n_threads % n_restart_threads);
+        if (parser.tempering_replicas > 0) {
+            tempering = std::make_shared<MCMC_Pt>(random_helper, parser.pid, parser.iterations_factor * matrix->getNQubits(), parser.enable_permutations,
+                                                  parser.tempering_replicas, parser.tempering_ratio, n_ladder_threads);
+            tempering->set_continue_ladder(parser.tempering_continue);
+            tempering->set_temp_scheme(algo2.getTemperatureScheme());
+            tempering->set_eq_comp(algo2.getEqualityComputer());
+            tempering->set_exact_eq_comp(exact_comp);
+            tempering->set_mutator(algo2.getMutator());
+            tempering->set_cancellation(cancellation);
+            engine = tempering.get();
+        }
+        // circuits on few qubits use matrices whose size is known at compile time
+        MatrixComputerType matrix_computer_type = matrix->getNQubits() <= max_fixed_qubits ? FixedBinary : Binary;
+        // if the constraints do not cover all columns, e.g. with ancillae or for state preparation, only the covered columns are computed
+        std::shared_ptr<const std::vector<int>> covered_columns = std::make_shared<const std::vector<int>>(matrix->coveredColumns(parser.enable_permutations));
+        bool restrict_columns = covered_columns->size() < pow(2, matrix->getNQubits());
+        // every thread checks the deadline itself, and a free thread starts the next restart as soon as it is done with its previous one
+        while (!cancellation->poll()) {
+            // in a batch, the thread only prepares and runs a restart while it holds cores of the batch: one, or with parallel tempering as many
+            // as the threads that step the replicas, out of those free
+            int n_cores_held = 0;
+            if (core_pool) {
+                n_cores_held = core_pool->acquire(*cancellation, tempering ? n_ladder_threads : 1);
+                if (n_cores_held == 0) {
+                    break;
+                }
+                if (tempering) {
+                    tempering->set_n_threads(n_cores_held);
+                }
+            }
             n_runs += 1;
             std::shared_ptr<GateCircuit> circ_init;
-            int startGates = parser.gateScheme.getStartGates(random_helper);
-            circ_init = std::make_shared<GateCircuit>(random_gen.randomGateCircuit(startGates, matrix->original.getNQubits(), ch, *algo2.getMutator()));
-            MCMCResult res = algo2.run(*matrix, circ_init, ch, false);
+            int startGates;
+            // the gate scheme of a worker is the one of its coordinator, which draws the start gates of all restarts
+            int epoch = 0;
+            if (link) {
+                startGates = link->nextStartGates(epoch);
+                if (startGates < 0) {
+                    if (core_pool) {
+                        core_pool->release(n_cores_held);
+                    }
+                    cancellation->cancel();
+                    break;
+                }
+            } else {
+                #pragma omp critical(gate_scheme)
+                startGates = parser.gateScheme.getStartGates(random_helper);
+            }
+            std::vector<GateId> elite;
+            bool warm_start = elite_pool && random_helper.random01() < parser.elite_fraction && elite_pool->sample(random_helper, elite);
+            if (warm_start) {
+                circ_init = std::make_shared<GateCircuit>(random_gen.perturbedGateCircuit(elite, startGates, matrix->original.getNQubits(), ch, *algo2.getMutator(), parser.elite_strength, matrix_computer_type));
+            } else {
+                circ_init = std::make_shared<GateCircuit>(random_gen.randomGateCircuit(startGates, matrix->original.getNQubits(), ch, *algo2.getMutator(), matrix_computer_type));
+            }
+            engine->set_temp_scheme(warm_start ? elite_start_scheme : random_start_scheme);
+            if (restrict_columns) {
+                circ_init->restrictToColumns(covered_columns);
+            }
+            MCMCResult res = engine->run(*matrix, circ_init, ch, false);
+            if (core_pool) {
+                core_pool->release(n_cores_held);
+            }
+            stop_reasons[res.stop_reason]++;
+            // a run cut short by the deadline can still have found its circuit in its last steps
             bool found = exact_comp->normalizedEqualityCost(*res.circuit_best, *matrix, ch) < 1e-3;
+            if (elite_pool && !found) {
+                elite_pool->add(*res.circuit_best, res.best_eq);
+            }
             
             if (found) {
                 successful_runs += 1;
@@ -319,18 +541,25 @@ std::map<std::string, double> Algorithm::run_inner_loop(std::shared_ptr<QubitInd
                 int tcount_before = best->getCount({"t", "tdg"});
                 int tdepth_before = best->getDepth({"t", "tdg"});
 
-                if (parser.do_resynth) {
-                    resynth.run(best, ch);
+                // a circuit whose simplification was cut by the deadline is dropped rather than saved, stored or kept as an elite unsimplified
+                if (parser.do_resynth && !resynth.run(best, ch)) {
+                    break;
+                }
+
+                if (elite_pool) {
+                    elite_pool->add(*best, 0.0);
                 }
 
-                if (parser.update_gate_scheme) {
-                    parser.gateScheme.update(best->getNbNonIdGates());
+                int scheme_gates = best->getNbNonIdGates();
+                if (parser.update_gate_scheme && !link) {
+                    #pragma omp critical(gate_scheme)
+                    parser.gateScheme.update(scheme_gates);
                 }
 
                 if (parser.expand_composite) {
                     best->expandCompositeGates();
-                    if (parser.do_resynth) {
-                        resynth.run(best, ch);
+                    if (parser.do_resynth && !resynth.run(best, ch)) {
+                        break;
                     }
                 }
 
@@ -338,16 +567,26 @@ std::map<std::string, double> Algorithm::run_inner_loop(std::shared_ptr<QubitInd
                 int tcount_after = best->getCount({"t", "tdg"});
                 int tdepth_after = best->getDepth({"t", "tdg"});
 
-                if (output_map["tcount"] == -1) {
-                    output_map["tcount"] = tcount_after;
-                    output_map["tdepth"] = tdepth_after;
-                    output_map["gatecount"] = gates_after;
-                    output_map["cost"] = best->getCost();
+                if (thread_output["tcount"] == -1) {
+                    thread_output["tcount"] = tcount_after;
+                    thread_output["tdepth"] = tdepth_after;
+                    thread_output["gatecount"] = gates_after;
+                    thread_output["cost"] = best->getCost();
                 } else {
-                    output_map["tcount"] = std::min(output_map["tcount"], (double) tcount_after);
-                    output_map["tdepth"] = std::min(output_map["tdepth"], (double) tdepth_after);
-                    output_map["gatecount"] = std::min(output_map["gatecount"], (double) gates_after);
-                    output_map["cost"] = std::min(output_map["cost"], best->getCost());
+                    thread_output["tcount"] = std::min(thread_output["tcount"], (double) tcount_after);
+                    thread_output["tdepth"] = std::min(thread_output["tdepth"], (double) tdepth_after);
+                    thread_output["gatecount"] = std::min(thread_output["gatecount"], (double) gates_after);
+                    thread_output["cost"] = std::min(thread_output["cost"], best->getCost());
+                }
+                if (store) {
+                    StoredCircuit stored;
+                    stored.tcount = tcount_after;
+                    stored.tdepth = tdepth_after;
+                    stored.gatecount = gates_after;
+                    stored.scheme_gates = scheme_gates;
+                    stored.cost = best->getCost();
+                    stored.qasm = best->print_qasm();
+                    store->record(stored);
                 }
                 
                 bool save_found_tcount = true;
@@ -375,60 +614,402 @@ std::map<std::string, double> Algorithm::run_inner_loop(std::shared_ptr<QubitInd
 
                 bool save_found = save_found_tcount && save_found_tdepth && save_found_gatecount && save_found_cost;
 
-                if ((parser.optimal_tdepth > -1 || parser.optimal_tcount > -1 || parser.cost_required > -1 || parser.optimal_gatecount > -1) && save_found) {
+                bool optimal = (parser.optimal_tdepth > -1 || parser.optimal_tcount > -1 || parser.cost_required > -1 || parser.optimal_gatecount > -1) && save_found;
+
+                if (link) {
+                    // the coordinator counts, reports and saves the circuits of all its workers
+                    FoundCircuit found_circuit;
+                    found_circuit.epoch = epoch;
+                    found_circuit.optimal = optimal;
+                    found_circuit.save = save_found;
+                    found_circuit.scheme_gates = scheme_gates;
+                    found_circuit.gates_before = gates_before;
+                    found_circuit.gates_after = gates_after;
+                    found_circuit.tcount_before = tcount_before;
+                    found_circuit.tcount_after = tcount_after;
+                    found_circuit.tdepth_before = tdepth_before;
+                    found_circuit.tdepth_after = tdepth_after;
+                    found_circuit.cost = best->getCost();
+                    found_circuit.count = best->getCount(parser.depth_gates);
+                    found_circuit.depth = best->getDepth(parser.depth_gates);
+                    found_circuit.qasm = best->print_qasm();
+                    if (!link->report(found_circuit)) {
+                        cancellation->cancel();
+                    }
+                    continue;
+                }
+
+                if (optimal) {
                     stop_inner = true;
+                    cancellation->cancel();
                     optimal_runs += 1;
                 }
 
+                int found_index = n_found_so_far;
                 if (save_found) {
-                    t_end_inner = std::chrono::high_resolution_clock::now();
-                    time_taken_inner = std::chrono::duration_cast<std::chrono::duration<double, std::ratio<1>>>(t_end_inner-t_start_inner).count();
-                    times.push_back(time_taken_inner);
-                    std::cout << parser.total_output_folder << " " << time_taken_inner << " " << n_found_so_far + 1 << std::endl;
-                    std::cout << "Gates: " << gates_before << " -> " << gates_after << std::endl;
-                    std::cout << "T-count: " << tcount_before << " -> " << tcount_after << std::endl;
-                    std::cout << "T-depth: " << tdepth_before << " -> " << tdepth_after << std::endl;
-                    t_start_inner = std::chrono::high_resolution_clock::now();
-                    n_found_so_far += 1;
+                    std::chrono::high_resolution_clock::rep now = std::chrono::high_resolution_clock::now().time_since_epoch().count();
+                    std::chrono::high_resolution_clock::duration since_last = std::chrono::high_resolution_clock::duration(now - last_found.exchange(now));
+                    double time_taken_inner = std::chrono::duration_cast<std::chrono::duration<double, std::ratio<1>>>(since_last).count();
+                    thread_times[id].push_back(time_taken_inner);
+                    found_index = ++n_found_so_far;
+                    if (found_index >= parser.n_found_stop) {
+                        cancellation->cancel();
+                    }
+                    std::ostringstream report;
+                    report << parser.total_output_folder << " " << time_taken_inner << " " << found_index << std::endl;
+                    report << "Gates: " << gates_before << " -> " << gates_after << std::endl;
+                    report << "T-count: " << tcount_before << " -> " << tcount_after << std::endl;
+                    report << "T-depth: " << tdepth_before << " -> " << tdepth_after << std::endl;
+                    std::cout << report.str() << std::flush;
                 }
 
                 if ((save_found || parser.save_all_circuits) && parser.save_any_circuit) {
                     double performance = best->getCost();
                     int count = best->getCount(parser.depth_gates);
                     int depth = best->getDepth(parser.depth_gates);
-                    std::string filename = std::to_string(performance) + "-" + std::to_string(count) + "-" + std::to_string(depth) + "-" + std::to_string(id) + "-" + std::to_string(n_found_so_far) + ".qasm";
+                    std::string filename = std::to_string(performance) + "-" + std::to_string(count) + "-" + std::to_string(depth) + "-" + std::to_string(id) + "-" + std::to_string(found_index) + ".qasm";
                     std::ofstream myfile;
                     myfile.open(parser.total_output_folder + filename);
                     myfile <<  best->print_qasm() << std::endl;
                     myfile.close();
                 }
             }
-            if (id == 0) {
-                t2_total = std::chrono::high_resolution_clock::now();
-                time_taken_total = std::chrono::duration_cast<std::chrono::duration<double, std::ratio<1>>>(t2_total-t1_total).count();
-            }
-        }   
+        }
+        cancellation->recordStop();
     }
 
+    cancellation_latency = std::max(cancellation_latency, cancellation->maxLatency());
+    for (int thread = 0; thread < n_restart_threads; thread++) {
+        times.insert(times.end(), thread_times[thread].begin(), thread_times[thread].end());
+        for (auto& [key, value] : thread_outputs[thread]) {
+            if (value != -1 && (output_map[key] == -1 || value < output_map[key])) {
+                output_map[key] = value;
+            }
+        }
+    }
+    t2_total = std::chrono::high_resolution_clock::now();
+    time_taken_total = elapsedTotal();
     return output_map;
 }
 
 /**
- * Runs the algorithm until the time limit or the number of desired solutions is reached.
+ * @brief Answers one message of a worker of the coordinator.
+ * 
+ * @param worker The connection to the worker.
+ * @param worker_id The index of the worker, set when it registers.
+ * @param line The line of the message, taken by Connection::takeMessage.
+ * @param payload The payload of the message, taken by Connection::takeMessage.
+ * @param deadline The deadline of the search.
+ * @return False if the connection to the worker is closed or the message is malformed, in which case the worker is dropped.
+ */
+bool Algorithm::serveMessage(Connection& worker, int& worker_id, const std::string& line, const std::string& payload, CancellationToken& deadline) {
+    std::istringstream fields(line);
+    std::string keyword;
+    fields >> keyword;
+    std::ostringstream reply;
+    if (keyword == "HELLO") {
+        worker_id = n_workers++;
+        reply << "SPEC " << worker_id << " " << deadline.remaining() << " " << forwarded_args.size() + 1 << " " << spec.size() << "\n";
+        reply << parser.input_name << "\n";
+        for (std::string& arg : forwarded_args) {
+            reply << arg << "\n";
+        }
+        reply << spec;
+        std::cout << "Worker " << worker_id << " connected" << std::endl;
+    } else if (keyword == "BATCH") {
+        int n_restarts;
+        if (!(fields >> n_restarts) || n_restarts < 0) {
+            return false;
+        }
+        n_restarts = std::min(n_restarts, max_batch_runs);
+        reply << "RUNS " << epoch;
+        for (int restart = 0; restart < n_restarts; restart++) {
+            n_runs += 1;
+            reply << " " << parser.gateScheme.getStartGates(coordinator_random);
+        }
+        reply << "\n";
+    } else if (keyword == "FOUND") {
+        FoundCircuit found;
+        if (!found.parse(fields, payload)) {
+            return false;
+        }
+        // a worker is not trusted: its circuit is read and checked against the target, and its counts are taken from the checked circuit
+        ExactEqualityComputer exact_comp = ExactEqualityComputer(parser.epsilon);
+        std::shared_ptr<GateCircuit> circuit = ResultStore::readCircuit(found.qasm, *served_matrix, *served_ch, exact_comp);
+        if (!circuit) {
+            std::cout << "Worker " << worker_id << " sent a circuit that does not implement the target" << std::endl;
+            return false;
+        }
+        found.gates_after = circuit->getNbNonIdGates();
+        found.tcount_after = circuit->getCount({"t", "tdg"});
+        found.tdepth_after = circuit->getDepth({"t", "tdg"});
+        found.cost = circuit->getCost();
+        found.count = circuit->getCount(parser.depth_gates);
+        found.depth = circuit->getDepth(parser.depth_gates);
+        found.qasm = circuit->print_qasm();
+        bool has_requirements = parser.optimal_tdepth > -1 || parser.optimal_tcount > -1 || parser.cost_required > -1 || parser.optimal_gatecount > -1;
+        found.save = (parser.optimal_tcount == -1 || found.tcount_after <= parser.optimal_tcount)
+            && (parser.optimal_tdepth == -1 || found.tdepth_after <= parser.optimal_tdepth)
+            && (parser.optimal_gatecount == -1 || found.gates_after <= parser.optimal_gatecount)
+            && (parser.cost_required == -1 || found.cost <= parser.cost_required);
+        found.optimal = has_requirements && found.save;
+        successful_runs += 1;
+        if (parser.update_gate_scheme) {
+            parser.gateScheme.update(found.scheme_gates);
+        }
+        if (store) {
+            StoredCircuit stored;
+            stored.tcount = found.tcount_after;
+            stored.tdepth = found.tdepth_after;
+            stored.gatecount = found.gates_after;
+            stored.scheme_gates = found.scheme_gates;
+            stored.cost = found.cost;
+            stored.qasm = found.qasm;
+            store->record(stored);
+        }
+        // circuits of an earlier epoch are not counted, like the circuits found by other threads once one has found an optimal circuit
+        bool save_found = found.save && found.epoch == epoch;
+        if (found.optimal && save_found) {
+            optimal_runs += 1;
+            epoch += 1;
+            parser.gateScheme.reset();
+        }
+        if (save_found) {
+            std::chrono::time_point<std::chrono::high_resolution_clock> now = std::chrono::high_resolution_clock::now();
+            double time_taken_inner = std::chrono::duration_cast<std::chrono::duration<double, std::ratio<1>>>(now - last_found).count();
+            last_found = now;
+            times.push_back(time_taken_inner);
+            n_found_so_far += 1;
+            std::cout << parser.total_output_folder << " " << time_taken_inner << " " << n_found_so_far << std::endl;
+            std::cout << "Gates: " << found.gates_before << " -> " << found.gates_after << std::endl;
+            std::cout << "T-count: " << found.tcount_before << " -> " << found.tcount_after << std::endl;
+            std::cout << "T-depth: " << found.tdepth_before << " -> " << found.tdepth_after << std::endl;
+        }
+        if ((save_found || parser.save_all_circuits) && parser.save_any_circuit) {
+            std::string filename = std::to_string(found.cost) + "-" + std::to_string(found.count) + "-" + std::to_string(found.depth) + "-" + std::to_string(worker_id) + "-" + std::to_string(n_found_so_far) + ".qasm";
+            std::ofstream myfile;
+            myfile.open(parser.total_output_folder + filename);
+            myfile << found.qasm << std::endl;
+            myfile.close();
+        }
+        if (n_found_so_far < parser.n_found_stop) {
+            reply << "OK " << epoch << "\n";
+        }
+    } else {
+        return false;
+    }
+    if (reply.str().empty() || n_found_so_far >= parser.n_found_stop) {
+        return worker.sendAll("STOP\n");
+    }
+    return worker.sendAll(reply.str());
+}
+
+/**
+ * @brief Runs the coordinator of a distributed search until the time limit or the number of desired solutions is reached. The coordinator does
+ * not search itself: it draws the start gates of the restarts of its workers from its gate scheme, and counts, reports and saves the circuits
+ * they find, as run does for its threads, once it has checked them against the target. Workers can connect and leave at any time.
+ * 
+ * @param matrix The target, with its permutations if they are enabled.
+ * @throws std::runtime_error If the input file cannot be read or the address cannot be listened on.
+ */
+void Algorithm::serve(std::shared_ptr<QubitIndependentPartialMatrix> matrix) {
+    std::ifstream spec_file(parser.base_input_folder + parser.input_name, std::ios::binary);
+    if (!spec_file.is_open()) {
+        throw std::runtime_error("Cannot read input file " + parser.base_input_folder + parser.input_name);
+    }
+    spec.assign(std::istreambuf_iterator<char>(spec_file), std::istreambuf_iterator<char>());
+    served_matrix = matrix;
+    served_ch = CircuitHelper::shared(matrix->getNQubits(), parser.base_gate_folder + parser.gate_set, parser.base_gate_folder + parser.composite_gate_folder);
+    coordinator_random.seed(0);
+    int listen_fd = Connection::listenOn(parser.serve_address);
+    std::cout << "Serving on " << parser.serve_address << std::endl;
+    std::vector<std::shared_ptr<Connection>> workers;
+    std::vector<int> worker_ids;
+    CancellationToken deadline(parser.time_allowed - elapsedTotal());
+    last_found = std::chrono::high_resolution_clock::now();
+    while (!deadline.poll() && n_found_so_far < parser.n_found_stop) {
+        std::vector<pollfd> fds = {{listen_fd, POLLIN, 0}};
+        for (std::shared_ptr<Connection>& worker : workers) {
+            fds.push_back({worker->getFd(), POLLIN, 0});
+        }
+        // wakes up regularly to check the deadline
+        int timeout_ms = (int) std::min(100.0, deadline.remaining() * 1000) + 1;
+        if (poll(fds.data(), fds.size(), timeout_ms) <= 0) {
+            continue;
+        }
+        std::vector<bool> dropped(workers.size(), false);
+        for (int w = 0; w < workers.size(); w++) {
+            if (!(fds[w + 1].revents & (POLLIN | POLLHUP | POLLERR))) {
+                continue;
+            }
+            // answers the messages received in full, and keeps a partial one for later rather than waiting for the rest of it
+            dropped[w] = !workers[w]->receive();
+            while (!dropped[w]) {
+                std::string line, payload;
+                bool complete;
+                dropped[w] = !workers[w]->takeMessage(line, payload, complete);
+                if (dropped[w] || !complete) {
+                    break;
+                }
+                dropped[w] = !serveMessage(*workers[w], worker_ids[w], line, payload, deadline);
+            }
+        }
+        for (int w = workers.size() - 1; w >= 0; w--) {
+            if (dropped[w]) {
+                workers.erase(workers.begin() + w);
+                worker_ids.erase(worker_ids.begin() + w);
+            }
+        }
+        if (fds[0].revents & POLLIN) {
+            std::shared_ptr<Connection> worker = Connection::acceptFrom(listen_fd);
+            if (worker) {
+                workers.push_back(worker);
+                worker_ids.push_back(-1);
+            }
+        }
+    }
+    // the workers stop once their connection is closed
+    workers.clear();
+    Connection::stopListening(listen_fd, parser.serve_address);
+    t2_total = std::chrono::high_resolution_clock::now();
+    time_taken_total = elapsedTotal();
+}
+
+/**
+ * @brief Opens the result store of the target. The circuits of the store that implement the target seed the elite pool, and the best number of
+ * gates of the store seeds the gate scheme. If some of them already meet the required T-count, T-depth, gate count or cost, they are reported
+ * and saved as found circuits, up to the number of circuits to find, and the search only looks for the others.
+ * 
+ * @param matrix The target, with its permutations if they are enabled.
+ * @return True if the store answered with all circuits to find, in which case no search is needed.
+ */
+bool Algorithm::openStore(std::shared_ptr<QubitIndependentPartialMatrix> matrix) {
+    CircuitHelper& ch = *CircuitHelper::shared(matrix->getNQubits(), parser.base_gate_folder + parser.gate_set, parser.base_gate_folder + parser.composite_gate_folder);
+    store = std::make_shared<ResultStore>(parser.store_folder, *matrix, std::vector<std::string>{ch.basic_gate_folder, ch.composite_gate_folder, ch.read_gate_folder});
+    store->load();
+    std::cout << "Result store: " << store->getPath() << ", " << store->circuits.size() << " circuits" << std::endl;
+    if (parser.update_gate_scheme && store->scheme_best_gates > 0) {
+        parser.gateScheme.setMinStartGates(store->scheme_min_gates);
+        parser.gateScheme.setMaxStartGates(store->scheme_max_gates);
+        parser.gateScheme.setStartBestGates(store->scheme_best_gates);
+        parser.gateScheme.reset();
+    }
+    if (parser.elite_size > 0 && !elite_pool) {
+        elite_pool = std::make_shared<ElitePool>(parser.elite_size);
+    }
+
+    bool has_requirements = parser.optimal_tdepth > -1 || parser.optimal_tcount > -1 || parser.cost_required > -1 || parser.optimal_gatecount > -1;
+    ExactEqualityComputer exact_comp = ExactEqualityComputer(parser.epsilon);
+    std::vector<std::shared_ptr<GateCircuit>> answers;
+    for (const StoredCircuit& stored : store->circuits) {
+        // a circuit stored with a larger tolerance than the one of this search is dropped here
+        std::shared_ptr<GateCircuit> circuit = store->restore(stored, *matrix, ch, exact_comp);
+        if (!circuit) {
+            continue;
+        }
+        if (elite_pool) {
+            elite_pool->add(*circuit, 0.0);
+        }
+        bool meets_requirements = has_requirements
+            && (parser.optimal_tcount == -1 || circuit->getCount({"t", "tdg"}) <= parser.optimal_tcount)
+            && (parser.optimal_tdepth == -1 || circuit->getDepth({"t", "tdg"}) <= parser.optimal_tdepth)
+            && (parser.optimal_gatecount == -1 || circuit->getNbNonIdGates() <= parser.optimal_gatecount)
+            && (parser.cost_required == -1 || circuit->getCost() <= parser.cost_required);
+        if (meets_requirements && answers.size() < parser.n_found_stop) {
+            answers.push_back(circuit);
+        }
+    }
+
+    for (std::shared_ptr<GateCircuit>& circuit : answers) {
+        int found_index = ++n_found_so_far;
+        int gates = circuit->getNbNonIdGates();
+        int tcount = circuit->getCount({"t", "tdg"});
+        int tdepth = circuit->getDepth({"t", "tdg"});
+        times.push_back(elapsedTotal());
+        std::cout << parser.total_output_folder << " " << elapsedTotal() << " " << found_index << std::endl;
+        std::cout << "Gates: " << gates << " -> " << gates << std::endl;
+        std::cout << "T-count: " << tcount << " -> " << tcount << std::endl;
+        std::cout << "T-depth: " << tdepth << " -> " << tdepth << std::endl;
+        if (parser.save_any_circuit) {
+            std::string filename = std::to_string(circuit->getCost()) + "-" + std::to_string(circuit->getCount(parser.depth_gates)) + "-" + std::to_string(circuit->getDepth(parser.depth_gates)) + "-0-" + std::to_string(found_index) + ".qasm";
+            std::ofstream myfile;
+            myfile.open(parser.total_output_folder + filename);
+            myfile << circuit->print_qasm() << std::endl;
+            myfile.close();
+        }
+    }
+    successful_runs += answers.size();
+    optimal_runs += answers.size();
+    // the stored circuits count towards the circuits to find, the search only looks for the others
+    if (answers.size() >= parser.n_found_stop) {
+        std::cout << "Answered from the result store" << std::endl;
+        return true;
+    }
+    if (!answers.empty()) {
+        std::cout << answers.size() << " circuits from the result store, searching for " << parser.n_found_stop - answers.size() << " more" << std::endl;
+    }
+    return false;
+}
+
+/**
+ * Runs the algorithm until the time limit or the number of desired solutions is reached, in this process, or as the coordinator of workers
+ * with --serve, or as a worker until its coordinator stops. With --store, the result store may answer without a search, and the circuits found
+ * are added to it at the end.
  */
 void Algorithm::run() {
-    int run = 0;
-    while (time_taken_total < parser.time_allowed && n_found_so_far < parser.n_found_stop) {
-        std::shared_ptr<QubitIndependentPartialMatrix> matrix = initMatrix();
-        run_inner_loop(matrix, run);
+    // the specification and its permutations do not change between runs, they are built once and shared by all of them
+    std::shared_ptr<QubitIndependentPartialMatrix> matrix;
+    bool answered = false;
+    if (!parser.store_folder.empty() && !link) {
+        matrix = initMatrix();
+        answered = openStore(matrix);
+    }
+    if (answered) {
         t2_total = std::chrono::high_resolution_clock::now();
-        time_taken_total = std::chrono::duration_cast<std::chrono::duration<double, std::ratio<1>>>(t2_total-t1_total).count();
-        parser.gateScheme.reset();
-        run += 1;
+        time_taken_total = elapsedTotal();
+    } else if (!parser.serve_address.empty()) {
+        if (!matrix) {
+            matrix = initMatrix();
+        }
+        serve(matrix);
+    } else {
+        int run = 0;
+        if (!matrix) {
+            matrix = initMatrix();
+        }
+        while (time_taken_total < parser.time_allowed && n_found_so_far < parser.n_found_stop && !(link && link->isStopped())) {
+            run_inner_loop(matrix, run);
+            t2_total = std::chrono::high_resolution_clock::now();
+            time_taken_total = std::chrono::duration_cast<std::chrono::duration<double, std::ratio<1>>>(t2_total-t1_total).count();
+            parser.gateScheme.reset();
+            run += 1;
 
+        }
+        std::cout << "Cancellation latency: " << cancellation_latency * 1000 << " ms" << std::endl;
+        std::cout << "Stop reasons:";
+        for (int reason = 0; reason < nbStopReasons; reason++) {
+            std::cout << " " << stop_reason_names[reason] << " " << stop_reasons[reason];
+        }
+        std::cout << std::endl;
+    }
+
+    if (store) {
+        // the gate scheme is reset between runs, so its learned bounds are the ones it converges to for the best circuit stored
+        int best_gates = -1;
+        for (const StoredCircuit& stored : store->circuits) {
+            if (best_gates < 0 || stored.scheme_gates < best_gates) {
+                best_gates = stored.scheme_gates;
+            }
+        }
+        store->setGateScheme(parser.gateScheme.getMinFactor() * best_gates, parser.gateScheme.getMaxFactor() * best_gates, best_gates);
+        if (!store->save()) {
+            std::cerr << "Cannot write the result store " << store->getPath() << std::endl;
+        }
     }
     
     if (parser.save_times) {
+        // the jobs of a batch can share their times file
+        std::lock_guard<std::mutex> lock(times_file_mutex);
         std::ofstream file;
         file.open(parser.times_file, std::ios_base::app);
         double mean_time = std::accumulate(times.begin(), times.end(), 0.0) / times.size();
@@ -2,11 +2,19 @@
 #define DEF_ALGO
 
 #include <chrono>
+#include <atomic>
 #include <memory>
 #include <map>
 
 #include "gateScheme.h"
 #include "partialMatrix.h"
+#include "cancellation.h"
+#include "distributed.h"
+#include "elite_pool.h"
+#include "result_store.h"
+#include "core_pool.h"
+#include "affinity.h"
+#include "stagnation.h"
 
 class Parser {
     public:
@@ -25,6 +33,9 @@ class Parser {
         std::string gate_set = "CliffordT";
         std::string composite_gate_folder = "composite_gates";
         std::string times_file = "data/times.csv";
+        std::string serve_address = ""; // address the coordinator listens on for workers, empty to search in this process
+        std::string store_folder = ""; // folder of the result store, empty to not use it
+        std::string affinity = "none"; // placement of the threads, see ThreadPlacement
 
         int n_threads = 1;
         int n_found_stop = 10;
@@ -51,6 +62,19 @@ class Parser {
         bool enable_permutations = true;
         bool do_resynth = true;
         bool simple_cost = false;
+        bool environment_cost = false;
+        bool heat_bath = false;
+        bool race_permutations = false;
+        int tempering_replicas = 0;
+        double tempering_ratio = 0.1;
+        bool tempering_continue = false;
+        int elite_size = 0;
+        double elite_fraction = 0.5;
+        double elite_strength = 0.2;
+        double elite_temp = 0.25;
+        double stagnation_window = 0; // sweeps of the circuit, 0 to let every annealing run use its whole step budget
+        double stagnation_improvement = 0;
+        double min_acceptance = 0;
 
         double n_norm = 80.0;
         int iterations_factor = 40;
@@ -72,17 +96,39 @@ class Algorithm {
         Algorithm();
         void run();
         std::map<std::string, double> run_inner_loop(std::shared_ptr<QubitIndependentPartialMatrix> matrix, int run=0);
+        void serve(std::shared_ptr<QubitIndependentPartialMatrix> matrix);
+        bool serveMessage(Connection& worker, int& worker_id, const std::string& line, const std::string& payload, CancellationToken& deadline);
+        bool openStore(std::shared_ptr<QubitIndependentPartialMatrix> matrix);
         std::shared_ptr<QubitIndependentPartialMatrix> initMatrix();
+        double elapsedTotal();
+        int nbLadders(int n_threads);
 
         Parser parser = Parser();
-        int n_found_so_far = 0;
-        int n_runs = 0;
-        int successful_runs = 0;
-        int optimal_runs = 0;
+        // updated by all threads of run_inner_loop
+        std::atomic<int> n_found_so_far = 0;
+        std::atomic<int> n_runs = 0;
+        std::atomic<int> successful_runs = 0;
+        std::atomic<int> optimal_runs = 0;
+        std::atomic<int> stop_reasons[nbStopReasons] = {}; // number of annealing runs by the reason they stopped
         std::chrono::time_point<std::chrono::high_resolution_clock> t1_total = std::chrono::high_resolution_clock::now();
         std::chrono::time_point<std::chrono::high_resolution_clock> t2_total = std::chrono::high_resolution_clock::now();
         double time_taken_total;
+        double cancellation_latency = 0; // longest time a thread took to stop after the deadline or the last circuit
         std::vector<double> times;
+        // state of a coordinator, see serve
+        std::vector<std::string> forwarded_args; // arguments of the coordinator, sent to its workers
+        std::string spec; // content of the input file, sent to the workers
+        std::shared_ptr<QubitIndependentPartialMatrix> served_matrix; // target against which the circuits of the workers are checked
+        std::shared_ptr<CircuitHelper> served_ch;
+        int epoch = 0;
+        int n_workers = 0;
+        RandomHelper coordinator_random = RandomHelper();
+        std::chrono::time_point<std::chrono::high_resolution_clock> last_found = std::chrono::high_resolution_clock::now();
+        std::shared_ptr<WorkerLink> link; // connection to the coordinator of a worker, nullptr otherwise
+        std::shared_ptr<ElitePool> elite_pool; // kept over all runs of the inner loop, nullptr without warm starts
+        std::shared_ptr<ResultStore> store; // nullptr without --store, and for workers, whose circuits are stored by their coordinator
+        std::shared_ptr<CorePool> core_pool; // cores shared with the other jobs of a batch, nullptr outside of a batch
+        ThreadPlacement placement; // CPUs of the threads of run_inner_loop
 };
 
 
@@ -0,0 +1,136 @@
+#include "circuit.h"
+#include "cost.h"
+#include "matrixGenerator.h"
+#include "mutation.h"
+#include "partialMatrix.h"
+#include "randomCircuit.h"
+#include "randomhelper.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+
+// the allocations are counted while counting is set, by replacing the allocation functions of the C and C++ libraries
+static bool counting = false;
+static long n_allocations = 0;
+
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t n, size_t size);
+extern "C" void* __libc_realloc(void* pointer, size_t size);
+
+extern "C" void* malloc(size_t size) {
+    n_allocations += counting;
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t n, size_t size) {
+    n_allocations += counting;
+    return __libc_calloc(n, size);
+}
+
+extern "C" void* realloc(void* pointer, size_t size) {
+    n_allocations += counting;
+    return __libc_realloc(pointer, size);
+}
+
+void* operator new(size_t size) {
+    n_allocations += counting;
+    void* pointer = __libc_malloc(size == 0 ? 1 : size);
+    if (pointer == nullptr) {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* pointer) noexcept {
+    free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+    free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    free(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept {
+    free(pointer);
+}
+
+/**
+ * @brief Runs steps of the search on a random circuit computed by a matrix computer: every step mutates the circuit, which updates its matrix,
+ * computes the cost of the circuit against all permuted targets, and accepts the mutation with the Metropolis criterion or undoes it.
+ *
+ * @param matrix The target, with its permutations.
+ * @param ch The CircuitHelper object of the gate set.
+ * @param type The type of the matrix computer.
+ * @param n_steps The number of steps counted, after as many steps to reach the steady state.
+ * @return The number of allocations during the counted steps.
+ */
+long countAllocations(QubitIndependentPartialMatrix& matrix, CircuitHelper& ch, MatrixComputerType type, int n_steps) {
+    RandomHelper random_helper = RandomHelper();
+    random_helper.seed(1);
+    RandomCircuitGen random_gen = RandomCircuitGen(random_helper, 0.3);
+    Mutator mutator = Mutator(0.3, 0.2);
+    GateCircuit circuit = random_gen.randomGateCircuit(80, matrix.getNQubits(), ch, mutator, type == Slab ? FixedBinary : type);
+    if (type == Slab) {
+        circuit.restrictToColumns(std::make_shared<const std::vector<int>>(matrix.coveredColumns(true)));
+    }
+    FroebeniusCostComputer froeb = FroebeniusCostComputer();
+    EqualityComputer& equality_computer = froeb;
+    double cur_cost = equality_computer.normalizedEqualityCost(circuit, matrix, ch);
+    double temperature = 0.05;
+    n_allocations = 0;
+    for (int step = 0; step < 2 * n_steps; step++) {
+        counting = step >= n_steps;
+        if (mutator.mutate(circuit, random_helper)) {
+            continue;
+        }
+        double cost = equality_computer.normalizedEqualityCost(circuit, matrix, ch);
+        if (cost <= cur_cost || random_helper.random01() <= std::exp(-(cost - cur_cost) / temperature)) {
+            cur_cost = cost;
+        } else {
+            mutator.undo_mutation(circuit);
+        }
+    }
+    counting = false;
+    return n_allocations;
+}
+
+/**
+ * @brief Checks that the steps of the search do not allocate once in steady state, for every type of matrix computer. The Slab computer
+ * computes the columns covered by the target with an ancilla added, and the others the full matrix of the target.
+ *
+ * Usage: alloc_bench [specification] [steps], with the specification relative to data/input, 64/comparison/ccx.txt by default.
+ *
+ * @param argc The number of command-line arguments.
+ * @param argv An array of command-line arguments.
+ * @return int 1 if a step allocates with any matrix computer, 0 otherwise.
+ */
+int main(int argc, char* argv[]) {
+    std::string spec = argc > 1 ? argv[1] : "64/comparison/ccx.txt";
+    int n_steps = argc > 2 ? std::stoi(argv[2]) : 10000;
+    PartialMatrix original = PartialMatrix("data/input/" + spec);
+    QubitIndependentPartialMatrix matrix = QubitIndependentPartialMatrix(original);
+    MatrixGenerator matrix_gen = MatrixGenerator();
+    PartialMatrix with_ancilla = matrix_gen.addAncilla(original, 1);
+    QubitIndependentPartialMatrix ancilla_matrix = QubitIndependentPartialMatrix(with_ancilla);
+    CircuitHelper ch = CircuitHelper(matrix.getNQubits());
+    CircuitHelper ancilla_ch = CircuitHelper(ancilla_matrix.getNQubits());
+
+    const std::string names[] = {"Linear", "Chunk", "Binary", "FixedBinary", "Slab"};
+    bool allocates = false;
+    for (MatrixComputerType type : {Linear, Chunk, Binary, FixedBinary, Slab}) {
+        long n = type == Slab ? countAllocations(ancilla_matrix, ancilla_ch, type, n_steps) : countAllocations(matrix, ch, type, n_steps);
+        std::cout << names[type] << ": " << n << " allocations in " << n_steps << " steps" << std::endl;
+        allocates = allocates || n != 0;
+    }
+    return allocates ? 1 : 0;
+}
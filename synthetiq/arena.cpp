@@ -0,0 +1,38 @@
+#include "arena.h"
+#include <cstdlib>
+#include <sys/mman.h>
+
+/**
+ * Allocates a block of memory aligned to a cache line. Blocks of at least one huge page are aligned to a huge page and the kernel is
+ * advised to back them with transparent huge pages, so that walking through them needs fewer TLB entries. The advice is only a hint
+ * and is ignored if transparent huge pages are disabled.
+ *
+ * @param bytes The size of the block.
+ * @return A pointer to the block, to be released with freeArena.
+ */
+void* allocateArena(std::size_t bytes) {
+    if (bytes == 0) {
+        bytes = arena_alignment;
+    }
+    bool huge = bytes >= huge_page_size;
+    std::size_t alignment = huge ? huge_page_size : arena_alignment;
+    void* pointer = nullptr;
+    if (posix_memalign(&pointer, alignment, bytes) != 0) {
+        throw std::bad_alloc();
+    }
+#ifdef MADV_HUGEPAGE
+    if (huge) {
+        madvise(pointer, bytes - bytes % huge_page_size, MADV_HUGEPAGE);
+    }
+#endif
+    return pointer;
+}
+
+/**
+ * @brief Releases a block allocated by allocateArena.
+ *
+ * @param pointer The pointer to the block.
+ */
+void freeArena(void* pointer) {
+    std::free(pointer);
+}
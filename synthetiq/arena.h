@@ -0,0 +1,36 @@
+#ifndef DEF_ARENA
+#define DEF_ARENA
+#include <cstddef>
+#include <new>
+
+const std::size_t arena_alignment = 64; // a cache line, and the widest vector register
+const std::size_t huge_page_size = 1 << 21;
+
+void* allocateArena(std::size_t bytes);
+void freeArena(void* pointer);
+
+template <typename T>
+class ArenaAllocator {
+    // allocator for std::vector that aligns the storage to a cache line, and large blocks to a huge page, see allocateArena
+    public:
+        typedef T value_type;
+        ArenaAllocator() {};
+        template <typename U>
+        ArenaAllocator(const ArenaAllocator<U>& other) {};
+        T* allocate(std::size_t n) {
+            return static_cast<T*>(allocateArena(n * sizeof(T)));
+        };
+        void deallocate(T* pointer, std::size_t n) {
+            freeArena(pointer);
+        };
+        template <typename U>
+        bool operator==(const ArenaAllocator<U>& other) const {
+            return true;
+        };
+        template <typename U>
+        bool operator!=(const ArenaAllocator<U>& other) const {
+            return false;
+        };
+};
+
+#endif
@@ -0,0 +1,43 @@
+#include "barrier.h"
+#include <algorithm>
+
+/**
+ * @brief Constructs a Barrier.
+ *
+ * @param n_threads The number of threads that wait on the barrier.
+ */
+Barrier::Barrier(int n_threads) : n_threads(std::max(1, n_threads)) {
+}
+
+/**
+ * @brief Sets the number of threads that wait on the barrier. Must be called while no thread waits on it.
+ *
+ * @param n_threads The number of threads.
+ */
+void Barrier::reset(int n_threads) {
+    std::lock_guard<std::mutex> lock(mutex);
+    this->n_threads = std::max(1, n_threads);
+    n_waiting = 0;
+}
+
+/**
+ * @brief Waits until all threads have reached the barrier, sleeping meanwhile. What the threads wrote before the barrier is visible to all of
+ * them after it.
+ *
+ * @return True for the last thread to arrive, which can do the serial work of the phase, false for the others.
+ */
+bool Barrier::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    long arrival_phase = phase;
+    n_waiting++;
+    if (n_waiting == n_threads) {
+        n_waiting = 0;
+        phase++;
+        released.notify_all();
+        return true;
+    }
+    while (phase == arrival_phase) {
+        released.wait(lock);
+    }
+    return false;
+}
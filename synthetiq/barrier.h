@@ -0,0 +1,24 @@
+#ifndef DEF_BARRIER
+#define DEF_BARRIER
+
+#include <condition_variable>
+#include <mutex>
+
+class Barrier {
+    // a barrier between the threads of a parallel region on which the waiting threads sleep, unlike the barriers of OpenMP, which spin by
+    // default and keep idle cores busy between short parallel phases
+    // usage: call reset with the number of threads of the region, then wait; exactly one thread of each phase, the last to arrive, gets true
+    public:
+        Barrier(int n_threads=1);
+        void reset(int n_threads);
+        bool wait();
+
+    private:
+        int n_threads;
+        int n_waiting = 0;
+        long phase = 0;
+        std::mutex mutex;
+        std::condition_variable released;
+};
+
+#endif
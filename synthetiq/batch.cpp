@@ -0,0 +1,116 @@
+#include "batch.h"
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+/**
+ * @brief Constructs a BatchRunner from the command line "main --batch <job file> [arguments of all jobs]" and reads the job file.
+ *
+ * @param argc The number of command-line arguments.
+ * @param argv An array of command-line arguments.
+ * @throws std::runtime_error If the job file cannot be read.
+ * @throws std::invalid_argument If threads are placed with --affinity other than by a CPU list of a job, which would put the threads of
+ * the jobs that run at the same time on the same CPUs.
+ */
+BatchRunner::BatchRunner(int argc, char* argv[]) {
+    program = argv[0];
+    n_cores = std::max(1u, std::thread::hardware_concurrency());
+    for (int arg = 3; arg < argc; arg++) {
+        if ((std::string(argv[arg]) == "--threads" || std::string(argv[arg]) == "-h") && arg + 1 < argc) {
+            n_cores = std::stoi(argv[arg + 1]);
+        }
+        common_args.push_back(argv[arg]);
+    }
+    // by default, a job can use all cores of the batch
+    common_args.insert(common_args.begin(), {"--threads", std::to_string(n_cores)});
+
+    std::ifstream file(argv[2]);
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot read job file " + std::string(argv[2]));
+    }
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream words(line);
+        std::vector<std::string> job;
+        std::string word;
+        while (words >> word) {
+            job.push_back(word);
+        }
+        if (!job.empty() && job[0][0] != '#') {
+            jobs.push_back(job);
+        }
+    }
+    // the cores of a batch go to whichever jobs run, so the CPUs of a job can only be known from its own CPU list
+    for (int arg = 0; arg + 1 < common_args.size(); arg++) {
+        if (common_args[arg] == "--affinity" && common_args[arg + 1] != "none") {
+            throw std::invalid_argument("A batch can only place the threads of a job with a CPU list on the line of the job");
+        }
+    }
+    for (std::vector<std::string>& job : jobs) {
+        for (int arg = 1; arg + 1 < job.size(); arg++) {
+            if (job[arg] == "--affinity" && (job[arg + 1] == "compact" || job[arg + 1] == "scatter")) {
+                throw std::invalid_argument("A batch can only place the threads of a job with a CPU list on the line of the job");
+            }
+        }
+    }
+}
+
+/**
+ * @brief Runs the jobs that are not started yet, one after the other, until none is left. Called by each launcher thread of the batch.
+ */
+void BatchRunner::runJobs() {
+    for (int job = next_job++; job < jobs.size(); job = next_job++) {
+        std::vector<std::string> args = {program, jobs[job][0]};
+        args.insert(args.end(), common_args.begin(), common_args.end());
+        args.insert(args.end(), jobs[job].begin() + 1, jobs[job].end());
+        // circuits are numbered per job, so jobs without their own output folder write to a subfolder of the common one
+        std::string output_folder = jobs[job][0].substr(0, jobs[job][0].rfind("."));
+        bool own_output = false;
+        for (int arg = 1; arg + 1 < args.size(); arg++) {
+            if (args[arg] == "--output" || args[arg] == "-o") {
+                output_folder = args[arg + 1];
+                own_output = arg >= 2 + common_args.size();
+            }
+        }
+        if (!own_output) {
+            args.insert(args.end(), {"--output", output_folder + "/job" + std::to_string(job)});
+        }
+        std::vector<char*> job_argv;
+        for (std::string& arg : args) {
+            job_argv.push_back(arg.data());
+        }
+        try {
+            Algorithm algo(job_argv.size(), job_argv.data());
+            algo.core_pool = core_pool;
+            algo.run();
+            std::ostringstream report;
+            report << "Job " << job << " done: " << jobs[job][0] << ", " << algo.n_found_so_far << " circuits in " << algo.time_taken_total << "s" << std::endl;
+            std::cout << report.str() << std::flush;
+        } catch (std::exception& e) {
+            std::cerr << "Job " << job << " failed: " << jobs[job][0] << ": " << e.what() << std::endl;
+        }
+        core_pool->finishJob();
+    }
+}
+
+/**
+ * @brief Runs all jobs. As many jobs as there are cores run at the same time, each with its share of the cores as threads, up to its own
+ * number of threads, and every restart of a job holds one core of the batch. Cores thus move to the jobs still running as the others finish,
+ * and a new job starts as soon as one is done.
+ */
+void BatchRunner::run() {
+    std::chrono::time_point<std::chrono::steady_clock> start = std::chrono::steady_clock::now();
+    core_pool = std::make_shared<CorePool>(n_cores, jobs.size());
+    std::vector<std::thread> launchers;
+    for (int launcher = 0; launcher < std::min(n_cores, (int) jobs.size()); launcher++) {
+        launchers.push_back(std::thread(&BatchRunner::runJobs, this));
+    }
+    for (std::thread& launcher : launchers) {
+        launcher.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Batch done: " << jobs.size() << " jobs on " << n_cores << " cores in " << seconds << "s" << std::endl;
+}
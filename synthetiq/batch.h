@@ -0,0 +1,31 @@
+#ifndef DEF_BATCH
+#define DEF_BATCH
+
+#include "algo.h"
+#include "core_pool.h"
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+class BatchRunner {
+    // runs the jobs of a job file in one process. Each line of the file is the input file of a job followed by its arguments, as for main,
+    // and the arguments given on the command line after the job file apply to all jobs before their own. Empty lines and lines starting
+    // with # are ignored. The number of threads of the command line is the number of cores of the batch, and the number of threads of a job
+    // is the most cores it can use at once.
+    public:
+        BatchRunner(int argc, char* argv[]);
+        void run();
+
+    private:
+        void runJobs();
+
+        std::string program;
+        std::vector<std::string> common_args;
+        std::vector<std::vector<std::string>> jobs;
+        int n_cores;
+        std::shared_ptr<CorePool> core_pool;
+        std::atomic<int> next_job = 0;
+};
+
+#endif
@@ -0,0 +1,99 @@
+#include "cancellation.h"
+#include <algorithm>
+#include <limits>
+
+/**
+ * @brief Constructs a CancellationToken without deadline, which is only cancelled explicitly.
+ */
+CancellationToken::CancellationToken() : cancelled(false), has_deadline(false), cancelled_at(0), max_latency(0) {
+}
+
+/**
+ * @brief Constructs a CancellationToken that is cancelled once the given time has passed.
+ *
+ * @param seconds The time in seconds from now to the deadline, the token is cancelled on its first poll if it is not positive.
+ */
+CancellationToken::CancellationToken(double seconds) : cancelled(false), has_deadline(true), cancelled_at(0), max_latency(0) {
+    deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(std::max(seconds, 0.0)));
+}
+
+/**
+ * @brief Cancels the token at the given moment, unless it is already cancelled.
+ *
+ * @param moment The moment of the cancellation on the monotonic clock.
+ */
+void CancellationToken::cancelAt(std::chrono::steady_clock::rep moment) {
+    std::chrono::steady_clock::rep none = 0;
+    cancelled_at.compare_exchange_strong(none, moment);
+    cancelled.store(true);
+}
+
+/**
+ * @brief Cancels the token now.
+ */
+void CancellationToken::cancel() {
+    cancelAt(std::chrono::steady_clock::now().time_since_epoch().count());
+}
+
+/**
+ * @brief Checks whether the token has been cancelled, without looking at the clock.
+ *
+ * @return True if the token has been cancelled.
+ */
+bool CancellationToken::isCancelled() {
+    return cancelled.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Checks whether the token has been cancelled or its deadline has passed, in which case it is cancelled at its deadline.
+ *
+ * @return True if the token has been cancelled.
+ */
+bool CancellationToken::poll() {
+    if (cancelled.load(std::memory_order_relaxed)) {
+        return true;
+    }
+    if (has_deadline && std::chrono::steady_clock::now() >= deadline) {
+        cancelAt(deadline.time_since_epoch().count());
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Returns the time left until the deadline.
+ *
+ * @return The time left in seconds, 0 if the token has been cancelled, and infinity if it has no deadline.
+ */
+double CancellationToken::remaining() {
+    if (poll()) {
+        return 0.0;
+    }
+    if (!has_deadline) {
+        return std::numeric_limits<double>::infinity();
+    }
+    return std::chrono::duration<double>(deadline - std::chrono::steady_clock::now()).count();
+}
+
+/**
+ * @brief Records that the calling thread has stopped working, so that the time it took to react to the cancellation is measured.
+ * Does nothing if the token has not been cancelled.
+ */
+void CancellationToken::recordStop() {
+    if (!cancelled.load()) {
+        return;
+    }
+    std::chrono::steady_clock::rep latency = std::chrono::steady_clock::now().time_since_epoch().count() - cancelled_at.load();
+    std::chrono::steady_clock::rep longest = max_latency.load();
+    while (latency > longest && !max_latency.compare_exchange_weak(longest, latency)) {
+    }
+}
+
+/**
+ * @brief Returns the longest time a thread took to stop after the cancellation.
+ *
+ * @return The latency in seconds, 0 if no thread stopped after a cancellation.
+ */
+double CancellationToken::maxLatency() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::duration(max_latency.load())).count();
+}
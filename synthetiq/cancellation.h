@@ -0,0 +1,33 @@
+#ifndef DEF_CANCELLATION
+#define DEF_CANCELLATION
+
+#include <atomic>
+#include <chrono>
+
+// number of steps between two polls of a token in the search loops, a power of two
+const int cancellation_poll_steps = 1024;
+
+class CancellationToken {
+    // shared by all threads of a search: it is cancelled explicitly or once its deadline has passed, and the long loops poll it every
+    // cancellation_poll_steps steps. The deadline is on the monotonic clock, whose reads on Linux go through the vDSO and cost a few nanoseconds.
+    public:
+        CancellationToken();
+        CancellationToken(double seconds);
+        void cancel();
+        bool isCancelled();
+        bool poll();
+        double remaining();
+        void recordStop();
+        double maxLatency();
+
+    private:
+        void cancelAt(std::chrono::steady_clock::rep moment);
+
+        std::atomic<bool> cancelled;
+        bool has_deadline;
+        std::chrono::steady_clock::time_point deadline;
+        std::atomic<std::chrono::steady_clock::rep> cancelled_at; // moment of the cancellation, 0 while not cancelled
+        std::atomic<std::chrono::steady_clock::rep> max_latency; // longest time a thread took to stop after the cancellation
+};
+
+#endif
@@ -13,7 +13,7 @@
  * @param matrix_computer_type The type of MatrixComputer to use.
  */
 GateCircuit::GateCircuit(CircuitHelper& circ_helper, MatrixComputerType matrix_computer_type) : matrix_computer_type(matrix_computer_type) {
-    ch = std::make_shared<CircuitHelper>(circ_helper);
+    ch = circ_helper.share();
 }
 
 /**
@@ -26,11 +26,8 @@ GateCircuit::GateCircuit(CircuitHelper& circ_helper, MatrixComputerType matrix_c
  */
 GateCircuit::GateCircuit(int nb_g, int nb_q, CircuitHelper& circ_helper, MatrixComputerType matrix_computer_type) : matrix_computer_type(matrix_computer_type) {
     nb_qbs = nb_q;
-    ch = std::make_shared<CircuitHelper>(circ_helper);
-    list_gates = {};
-    for(int cur_g = 0; cur_g < nb_g; cur_g++){
-        list_gates.push_back(ch->id_gate);
-    }
+    ch = circ_helper.share();
+    list_gates = std::vector<GateId>(nb_g, ch->id_gate->id);
     initializeMatrixComputer();
     matrixComputer->calculateMatrix(list_gates);
     calculateCost();
@@ -49,8 +46,27 @@ GateCircuit::GateCircuit(GateCircuit const& other): nb_qbs(other.nb_qbs), ch(oth
     cost = other.cost;
     pos_mutation = other.pos_mutation;
     matrix_computer_type = other.matrix_computer_type;
+    slab_columns = other.slab_columns;
+    initializeMatrixComputer();
+    matrixComputer->calculateMatrix(list_gates);
+}
+
+/**
+ * @brief Constructs a GateCircuit with the same qubits, gate table and matrix computer as another one, but with other gates.
+ * 
+ * @param other The GateCircuit object to be copied.
+ * @param gates The ids of the gates of the new circuit, in the gate table of other.
+ */
+GateCircuit::GateCircuit(GateCircuit const& other, const std::vector<GateId>& gates): nb_qbs(other.nb_qbs), ch(other.ch) {
+    list_gates = gates;
+    old_gate = other.old_gate;
+    new_gate = other.new_gate;
+    pos_mutation = other.pos_mutation;
+    matrix_computer_type = other.matrix_computer_type;
+    slab_columns = other.slab_columns;
     initializeMatrixComputer();
     matrixComputer->calculateMatrix(list_gates);
+    calculateCost();
 }
 
 /**
@@ -62,17 +78,54 @@ std::shared_ptr<GateCircuit> GateCircuit::clone() {
     return std::make_shared<GateCircuit>(*this);
 }
 
+/**
+ * @brief Clones the GateCircuit object with other gates, see the corresponding constructor.
+ * 
+ * @param gates The ids of the gates of the clone.
+ * @return A shared pointer to the cloned GateCircuit object.
+ */
+std::shared_ptr<GateCircuit> GateCircuit::clone(const std::vector<GateId>& gates) {
+    return std::make_shared<GateCircuit>(*this, gates);
+}
+
+/**
+ * @brief Makes this circuit a copy of another one. If both have the same qubits, gate table and matrix computer, the matrix computer of this
+ * circuit is kept and recalculated, so that it reuses its memory, as the copy constructor would allocate a new one.
+ * 
+ * @param other The GateCircuit object to be copied.
+ */
+void GateCircuit::copyFrom(GateCircuit const& other) {
+    bool same_computer = matrixComputer != nullptr && calculating_matrix_computer && nb_qbs == other.nb_qbs && ch == other.ch
+                         && matrix_computer_type == other.matrix_computer_type && slab_columns == other.slab_columns;
+    nb_qbs = other.nb_qbs;
+    ch = other.ch;
+    list_gates = other.list_gates;
+    old_gate = other.old_gate;
+    new_gate = other.new_gate;
+    nb_non_id_gates = other.nb_non_id_gates;
+    cost = other.cost;
+    pos_mutation = other.pos_mutation;
+    matrix_computer_type = other.matrix_computer_type;
+    slab_columns = other.slab_columns;
+    calculating_matrix_computer = true;
+    can_rollback = false;
+    if (!same_computer) {
+        initializeMatrixComputer();
+    }
+    matrixComputer->calculateMatrix(list_gates);
+}
+
 /**
  * @brief Constructs a GateCircuit object.
  * 
- * @param gates The vector of shared pointers to Gate objects representing the gates in the circuit.
+ * @param gates The ids of the gates in the circuit, in the gate table of the CircuitHelper.
  * @param nb_q The number of qubits in the circuit.
  * @param circ_helper The CircuitHelper object used for circuit operations.
  * @param matrix_computer_type The type of MatrixComputer used for matrix calculations.
  */
-GateCircuit::GateCircuit(std::vector<std::shared_ptr<Gate>> gates, int nb_q, CircuitHelper& circ_helper, MatrixComputerType matrix_computer_type): 
+GateCircuit::GateCircuit(std::vector<GateId> gates, int nb_q, CircuitHelper& circ_helper, MatrixComputerType matrix_computer_type): 
         nb_qbs(nb_q), list_gates(gates), matrix_computer_type(matrix_computer_type) {
-    ch = std::make_shared<CircuitHelper>(circ_helper);
+    ch = circ_helper.share();
     initializeMatrixComputer();
     matrixComputer->calculateMatrix(gates);
     calculateCost();
@@ -100,7 +153,7 @@ void GateCircuit::readGateFromQasmInputLine(std::string line) {
     std::vector<int> acting_qubits_gate = Utils::readActingQubitsQasmLine(line);
     std::shared_ptr<Gate> gate_to_add = Gate::findCorrectGate(ch->readable_gates, gate_name, acting_qubits_gate);
     if (gate_to_add) {
-            list_gates.push_back(gate_to_add);
+            list_gates.push_back(gate_to_add->id);
     } else {
         throw std::invalid_argument("Gate in line cannot be constructed. Line: " + line);
     }
@@ -114,6 +167,15 @@ void GateCircuit::readGateFromQasmInputLine(std::string line) {
 void GateCircuit::readFromInput(std::string filename){ //cin stream
     std::ifstream file;
     file.open(filename);
+    readFromQasm(file);
+}
+
+/**
+ * Reads a gate circuit in the qasm format printed by print_qasm.
+ * 
+ * @param file The stream to read the circuit from.
+ */
+void GateCircuit::readFromQasm(std::istream& file){
     std::string line;
     std::regex words_regex("[^\\s\\[\\],]+");
 
@@ -127,7 +189,7 @@ void GateCircuit::readFromInput(std::string filename){ //cin stream
     words_begin++;
     nb_qbs = atoi((*words_begin).str().c_str());
     if (nb_qbs != ch->nb_qbs) {
-        ch = std::make_shared<CircuitHelper>(CircuitHelper(nb_qbs, ch->basic_gate_folder, ch->composite_gate_folder, ch->read_gate_folder));
+        ch = CircuitHelper::shared(nb_qbs, ch->basic_gate_folder, ch->composite_gate_folder, ch->read_gate_folder);
     }
     while (std::getline(file, line)) {
         readGateFromQasmInputLine(line);
@@ -150,7 +212,7 @@ void GateCircuit::readFromInputNonQuasm(std::string filename, int nb_l_to_ignore
     std::string line;
     nb_qbs = nb_qbs_in_circ;
     if (nb_qbs != ch->nb_qbs) {
-        ch = std::make_shared<CircuitHelper>(CircuitHelper(nb_qbs, ch->basic_gate_folder, ch->composite_gate_folder, ch->read_gate_folder));
+        ch = CircuitHelper::shared(nb_qbs, ch->basic_gate_folder, ch->composite_gate_folder, ch->read_gate_folder);
     }
 
     for(int i = 0; i < nb_l_to_ignore; i++)
@@ -180,7 +242,7 @@ void GateCircuit::readFromIfStream(std::ifstream& file){
     nb_qbs = atoi(splitOnSpace[2].c_str());
     int nb_gates = atoi(splitOnSpace[6].c_str());
     if (nb_qbs != ch->nb_qbs) {
-        ch = std::make_shared<CircuitHelper>(CircuitHelper(nb_qbs, ch->basic_gate_folder, ch->composite_gate_folder, ch->read_gate_folder));
+        ch = CircuitHelper::shared(nb_qbs, ch->basic_gate_folder, ch->composite_gate_folder, ch->read_gate_folder);
     }
 
     for(int i = 0; i < nb_gates; i++){
@@ -205,11 +267,12 @@ std::string GateCircuit::print_qasm(){
     oss << "OPENQASM 2.0;\n" << "include \"qelib1.inc\";\n" << "qreg qubits[" << std::to_string(nb_qbs) << "];\n";
     std::vector<std::string> gate_names = {"h", "p", "pdg", "t", "tdg", "id", "cx", "x", "y", "z"}; 
     for(size_t i = 0; i < list_gates.size(); i++)
-        if(list_gates[i]->name != ch->id_gate->name) {
-            oss << list_gates[i]->name;
-            for (int qb = 0; qb < list_gates[i]->acting_qubits.size(); qb++) {
-                oss << " qubits[" << std::to_string(list_gates[i]->acting_qubits[qb]) << "]";
-                if (qb != list_gates[i]->acting_qubits.size() - 1) {
+        if(!isIdentityAt(i)) {
+            const std::shared_ptr<Gate>& gate = getGate(i);
+            oss << gate->name;
+            for (int qb = 0; qb < gate->acting_qubits.size(); qb++) {
+                oss << " qubits[" << std::to_string(gate->acting_qubits[qb]) << "]";
+                if (qb != gate->acting_qubits.size() - 1) {
                     oss << ",";
                 }
             }                
@@ -223,14 +286,35 @@ std::string GateCircuit::print_qasm(){
  * If `matrix_computer_type` is Linear, a LinearMatrixComputer is created and assigned to `matrixComputer`.
  * If `matrix_computer_type` is Chunk, a ChunkMatrixComputer is created with the specified number of gates and qubits, and assigned to `matrixComputer`.
  * If `matrix_computer_type` is Binary, a BinaryMatrixComputer is created with the specified number of gates and qubits, and assigned to `matrixComputer`.
+ * If `matrix_computer_type` is FixedBinary, a BinaryMatrixComputerT specialized for the number of qubits is created and assigned to `matrixComputer`.
+ * If `matrix_computer_type` is Slab, a SlabMatrixComputer computing the columns in `slab_columns` is created and assigned to `matrixComputer`.
  */
 void GateCircuit::initializeMatrixComputer() {
     if (matrix_computer_type == Linear) {
-        matrixComputer = std::make_shared<LinearMatrixComputer>(LinearMatrixComputer());
+        matrixComputer = std::make_shared<LinearMatrixComputer>(LinearMatrixComputer(ch));
     } else if (matrix_computer_type == Chunk) {
-        matrixComputer = std::make_shared<ChunkMatrixComputer>(ChunkMatrixComputer(list_gates.size(), nb_qbs));
+        matrixComputer = std::make_shared<ChunkMatrixComputer>(ChunkMatrixComputer(list_gates.size(), nb_qbs, ch));
     } else if (matrix_computer_type == Binary) {
-        matrixComputer = std::make_shared<BinaryMatrixComputer>(BinaryMatrixComputer(list_gates.size(), nb_qbs));
+        matrixComputer = std::make_shared<BinaryMatrixComputer>(BinaryMatrixComputer(list_gates.size(), nb_qbs, ch));
+    } else if (matrix_computer_type == FixedBinary) {
+        matrixComputer = createFixedBinaryMatrixComputer(list_gates.size(), nb_qbs, ch);
+    } else if (matrix_computer_type == Slab) {
+        matrixComputer = std::make_shared<SlabMatrixComputer>(SlabMatrixComputer(nb_qbs, slab_columns, ch));
+    }
+}
+
+/**
+ * Only computes the given columns of the matrix of the circuit from now on, using a SlabMatrixComputer.
+ * The other entries of the matrix are zero, so this should only be used if the constraints do not cover them.
+ *
+ * @param columns The columns of the matrix to compute.
+ */
+void GateCircuit::restrictToColumns(std::shared_ptr<const std::vector<int>> columns) {
+    slab_columns = columns;
+    matrix_computer_type = Slab;
+    initializeMatrixComputer();
+    if (calculating_matrix_computer) {
+        matrixComputer->calculateMatrix(list_gates);
     }
 }
 
@@ -241,9 +325,10 @@ void GateCircuit::initializeMatrixComputer() {
  * @return The count of gates that match the given gate names.
  */
 int GateCircuit::getCount(std::vector<std::string> gate_names) {
+    std::vector<bool> named = ch->gatesNamed(gate_names);
     int count = 0;
-    for (std::shared_ptr<Gate> gate : list_gates) {
-        if (std::find(gate_names.begin(), gate_names.end(), gate->name) != gate_names.end()) {
+    for (GateId gate : list_gates) {
+        if (named[gate]) {
             count += 1;
         }
     }
@@ -259,15 +344,17 @@ int GateCircuit::getCount(std::vector<std::string> gate_names) {
  * @return The depth of the circuit.
  */
 int GateCircuit::getDepth(std::vector<std::string> gate_names) {
+    std::vector<bool> named = ch->gatesNamed(gate_names);
     std::vector<int> depths(nb_qbs);
-    for (std::shared_ptr<Gate> gate : list_gates) {
-        bool find = std::find(gate_names.begin(), gate_names.end(), gate->name) != gate_names.end();
+    for (GateId gate_id : list_gates) {
+        bool find = named[gate_id];
+        const std::vector<int>& acting_qubits = ch->readable_gates[gate_id]->acting_qubits;
         int max_depth_acting = 0;
-        for (int index : gate->acting_qubits) {
+        for (int index : acting_qubits) {
             max_depth_acting = std::max(max_depth_acting, depths[index]);
         }
 
-        for (int index : gate->acting_qubits) {
+        for (int index : acting_qubits) {
             if (find) {
                 depths[index] = max_depth_acting + 1;
             } else {
@@ -286,9 +373,9 @@ int GateCircuit::getDepth(std::vector<std::string> gate_names) {
  * If the matrix computer is currently calculating the matrix (this is turned of in the simplification pass for more efficiency), it updates the matrix with the new gate.
  * 
  * @param position The position of the gate to be replaced.
- * @param gate The new gate to be placed at the specified position.
+ * @param gate The id of the new gate to be placed at the specified position.
  */
-void GateCircuit::placeGateAt(int position, std::shared_ptr<Gate> gate){ //replaces gate at pos with new gate, assumes qbs of size 2
+void GateCircuit::placeGateAt(int position, GateId gate){ //replaces gate at pos with new gate, assumes qbs of size 2
     updateCost(gate, list_gates[position]);
     new_gate = gate;
     old_gate = list_gates[position];
@@ -296,10 +383,21 @@ void GateCircuit::placeGateAt(int position, std::shared_ptr<Gate> gate){ //repla
     if (calculating_matrix_computer) {
         matrixComputer->updateMatrix(position, list_gates);
     }
+    can_rollback = calculating_matrix_computer;
     
     pos_mutation = position;
 }
 
+/**
+ * @brief Replaces the gate at the specified position with a new gate of the gate table of the circuit.
+ * 
+ * @param position The position of the gate to be replaced.
+ * @param gate The new gate to be placed at the specified position.
+ */
+void GateCircuit::placeGateAt(int position, const std::shared_ptr<Gate>& gate){
+    placeGateAt(position, gate->id);
+}
+
 /**
  * Expands composite gates in the circuit.
  * This function replaces composite gates with their equivalent basic gates.
@@ -307,13 +405,13 @@ void GateCircuit::placeGateAt(int position, std::shared_ptr<Gate> gate){ //repla
  */
 void GateCircuit::expandCompositeGates() {
     stopMatrixComputer();
-    std::vector<std::shared_ptr<Gate>> new_list_gates;
+    std::vector<GateId> new_list_gates;
     for (int i = 0; i < list_gates.size(); i++) {
-        if (list_gates[i]->isBasicGate()) {
+        if (getGate(i)->isBasicGate()) {
             new_list_gates.push_back(list_gates[i]);
         } else {
-            for (std::shared_ptr<Gate> gate : list_gates[i]->decomposeInBasicGates()) {
-                new_list_gates.push_back(gate);
+            for (std::shared_ptr<Gate> gate : getGate(i)->decomposeInBasicGates()) {
+                new_list_gates.push_back(gate->id);
             }
         }
     }
@@ -330,9 +428,9 @@ void GateCircuit::expandCompositeGates() {
 void GateCircuit::calculateCost() {
     cost = 0.0;
     nb_non_id_gates = 0;
-    for (std::shared_ptr<Gate> gate : list_gates) {
-        cost += gate->cost;
-        if (gate->name != ch->id_gate->name) {
+    for (GateId gate : list_gates) {
+        cost += ch->gate_flags[gate].cost;
+        if (!ch->gate_flags[gate].is_identity) {
             nb_non_id_gates += 1;
         }
     }
@@ -342,15 +440,15 @@ void GateCircuit::calculateCost() {
  * Updates the cost of the gate circuit by subtracting the cost of the old gate and adding the cost of the new gate.
  * Additionally, it adjusts the count of non-identity gates based on whether the old or new gate is an identity gate.
  * 
- * @param new_gate The new gate to be added to the circuit.
- * @param old_gate The old gate to be removed from the circuit.
+ * @param new_gate The id of the new gate to be added to the circuit.
+ * @param old_gate The id of the old gate to be removed from the circuit.
  */
-void GateCircuit::updateCost(std::shared_ptr<Gate> new_gate, std::shared_ptr<Gate> old_gate) {
-    cost += new_gate->cost - old_gate->cost;
-    if (new_gate->name == ch->id_gate->name) {
+void GateCircuit::updateCost(GateId new_gate, GateId old_gate) {
+    cost += ch->gate_flags[new_gate].cost - ch->gate_flags[old_gate].cost;
+    if (ch->gate_flags[new_gate].is_identity) {
         nb_non_id_gates -= 1;
     }
-    if (old_gate->name == ch->id_gate->name) {
+    if (ch->gate_flags[old_gate].is_identity) {
         nb_non_id_gates += 1;
     }
 }
@@ -382,6 +480,15 @@ Eigen::MatrixXcd GateCircuit::toMatrix(){
     return matrixComputer->getMatrix();
 }
 
+/**
+ * @brief Returns the entries of the matrix of the GateCircuit in column-major order, without copying them.
+ * 
+ * @return A pointer to the entries of the matrix, valid until the circuit changes.
+ */
+const std::complex<double>* GateCircuit::matrixData(){
+    return matrixComputer->getMatrixData();
+}
+
 /**
  * Stops the matrix computer for the gate circuit.
  */
@@ -398,14 +505,34 @@ void GateCircuit::startMatrixComputer() {
 }
 
 /**
- * @brief Returns the list of gates in the circuit.
+ * @brief Returns the ids of the gates in the circuit, without copying them.
  * 
- * @return The list of gates in the circuit.
+ * @return The ids of the gates in the circuit, in the gate table of the CircuitHelper.
  */
-const std::vector<std::shared_ptr<Gate>> GateCircuit::getGates(){
+const std::vector<GateId>& GateCircuit::getGateIds(){
     return list_gates;
 }
 
+/**
+ * @brief Returns the gate at the given position in the circuit.
+ * 
+ * @param position The position of the gate.
+ * @return The gate at the given position.
+ */
+const std::shared_ptr<Gate>& GateCircuit::getGate(int position){
+    return ch->readable_gates[list_gates[position]];
+}
+
+/**
+ * @brief Checks whether the gate at the given position is the identity.
+ * 
+ * @param position The position of the gate.
+ * @return True if the gate at the given position is the identity, false otherwise.
+ */
+bool GateCircuit::isIdentityAt(int position){
+    return ch->gate_flags[list_gates[position]].is_identity;
+}
+
 /**
  * @brief Get the CircuitHelper object.
  * 
@@ -426,45 +553,90 @@ int GateCircuit::performanceNormalizationCst(){
 }
 
 /**
- * Mutates a gate in the circuit at the specified position.
+ * Draws a random gate from the gate table with the distribution used by the mutations.
  * 
  * @param random_helper The random number generator helper.
- * @param position The position of the gate to mutate.
  * @param proportional_prob The proportional probability for composite gates in the circuit, P_comp in the paper.
  * @param proba_id The probability of selecting an identity gate.
- * @return True if the gate remains unchanged after mutation, false otherwise.
+ * @param proba_name The probability of first selecting the name of the gate and then its qubits.
+ * @return The id of the drawn gate.
  */
-bool GateCircuit::mutate(RandomHelper& random_helper, int position, double proportional_prob, double proba_id, double proba_name){
-    bool unchanged = false;
-    //create potential mutation
+GateId GateCircuit::drawGate(RandomHelper& random_helper, double proportional_prob, double proba_id, double proba_name){
     double mutation = random_helper.random01();
-    old_gate = list_gates[position];
-    pos_mutation = position;
-    // create candidate
     if (mutation < proba_id){
-        new_gate = ch->id_gate;
+        return ch->id_gate->id;
     }
     else if (random_helper.random01() < proba_name) {
         double prob_basic_gate = (ch->basic_gates_by_name.size()) / (ch->basic_gates_by_name.size() + proportional_prob * ch->composite_gates_by_name.size());
         if (random_helper.random01() < prob_basic_gate) {
             int random1 = random_helper.randomInt(ch->basic_gates_by_name.size());
             int random2 = random_helper.randomInt(ch->basic_gates_by_name[random1].size());
-            new_gate = ch->basic_gates_by_name[random1][random2];
+            return ch->basic_gates_by_name[random1][random2]->id;
         } else {
             int random1 = random_helper.randomInt(ch->composite_gates_by_name.size());
             int random2 = random_helper.randomInt(ch->composite_gates_by_name[random1].size());
-            new_gate = ch->composite_gates_by_name[random1][random2];
+            return ch->composite_gates_by_name[random1][random2]->id;
         }
     }
     else {
         double prob_basic_gate = (ch->basic_gates.size()) / (ch->basic_gates.size() + proportional_prob * ch->composite_gates.size());
         if (random_helper.random01() < prob_basic_gate) {
-            new_gate = ch->basic_gates[random_helper.randomInt(ch->basic_gates.size())];
+            return ch->basic_gates[random_helper.randomInt(ch->basic_gates.size())]->id;
         } else {
-            new_gate = ch->composite_gates[random_helper.randomInt(ch->composite_gates.size())];
+            return ch->composite_gates[random_helper.randomInt(ch->composite_gates.size())]->id;
         }
     }
-    if (old_gate->equals(*new_gate)) {
+}
+
+/**
+ * Calculates the probability with which drawGate returns each gate of the gate table.
+ * 
+ * @param probabilities Is set to the probability of each gate, indexed by gate id.
+ * @param proportional_prob The proportional probability for composite gates in the circuit, P_comp in the paper.
+ * @param proba_id The probability of selecting an identity gate.
+ * @param proba_name The probability of first selecting the name of the gate and then its qubits.
+ */
+void GateCircuit::gateProbabilities(std::vector<double>& probabilities, double proportional_prob, double proba_id, double proba_name){
+    probabilities.assign(ch->readable_gates.size(), 0.0);
+    probabilities[ch->id_gate->id] += proba_id;
+    double prob_basic_name = (ch->basic_gates_by_name.size()) / (ch->basic_gates_by_name.size() + proportional_prob * ch->composite_gates_by_name.size());
+    for (const std::vector<std::shared_ptr<Gate>>& gates : ch->basic_gates_by_name) {
+        for (const std::shared_ptr<Gate>& gate : gates) {
+            probabilities[gate->id] += (1 - proba_id) * proba_name * prob_basic_name / ch->basic_gates_by_name.size() / gates.size();
+        }
+    }
+    for (const std::vector<std::shared_ptr<Gate>>& gates : ch->composite_gates_by_name) {
+        for (const std::shared_ptr<Gate>& gate : gates) {
+            probabilities[gate->id] += (1 - proba_id) * proba_name * (1 - prob_basic_name) / ch->composite_gates_by_name.size() / gates.size();
+        }
+    }
+    double prob_basic = (ch->basic_gates.size()) / (ch->basic_gates.size() + proportional_prob * ch->composite_gates.size());
+    for (const std::shared_ptr<Gate>& gate : ch->basic_gates) {
+        probabilities[gate->id] += (1 - proba_id) * (1 - proba_name) * prob_basic / ch->basic_gates.size();
+    }
+    for (const std::shared_ptr<Gate>& gate : ch->composite_gates) {
+        probabilities[gate->id] += (1 - proba_id) * (1 - proba_name) * (1 - prob_basic) / ch->composite_gates.size();
+    }
+}
+
+/**
+ * Mutates a gate in the circuit at the specified position.
+ * 
+ * @param random_helper The random number generator helper.
+ * @param position The position of the gate to mutate.
+ * @param proportional_prob The proportional probability for composite gates in the circuit, P_comp in the paper.
+ * @param proba_id The probability of selecting an identity gate.
+ * @return True if the gate remains unchanged after mutation, false otherwise.
+ */
+bool GateCircuit::mutate(RandomHelper& random_helper, int position, double proportional_prob, double proba_id, double proba_name){
+    bool unchanged = false;
+    old_gate = list_gates[position];
+    pos_mutation = position;
+    can_rollback = false;
+    // create candidate
+    new_gate = drawGate(random_helper, proportional_prob, proba_id, proba_name);
+    // every gate appears once in the gate table, so equal gates have equal ids
+    if (old_gate == new_gate) {
         unchanged = true;
     } else {
         placeGateAt(position, new_gate);
@@ -488,9 +660,18 @@ bool GateCircuit::mutate(RandomHelper& random_helper, double proportional_prob,
 
 /**
  * Undoes the previous mutation by placing the original gate back at the specified position.
+ * If the matrix computer supports it, the matrix is rolled back to its state before the mutation instead of being recomputed.
  */
 void GateCircuit::undoMutation() {
-    placeGateAt(pos_mutation, old_gate);
+    if (can_rollback && matrixComputer->rollback()) {
+        updateCost(old_gate, list_gates[pos_mutation]);
+        new_gate = old_gate;
+        old_gate = list_gates[pos_mutation];
+        list_gates[pos_mutation] = new_gate;
+        can_rollback = false;
+    } else {
+        placeGateAt(pos_mutation, old_gate);
+    }
 }
 /**
  * Applies the mutation again to another GateCircuit.
@@ -514,15 +695,16 @@ void GateCircuit::applyMutationAgain(GateCircuit& other){
 void GateCircuit::changeQubits(std::vector<int> qbs_order) {
     stopMatrixComputer();
     for (int i = 0; i < nbElements(); i++) {
+        const std::shared_ptr<Gate>& old = getGate(i);
         std::vector<int> acting_qubits = {};
-        for (int j = 0; j < list_gates[i]->acting_qubits.size(); j++) {
-            if (list_gates[i]->name != ch->id_gate->name) {
-                acting_qubits.push_back(qbs_order[list_gates[i]->acting_qubits[j]]);
+        for (int j = 0; j < old->acting_qubits.size(); j++) {
+            if (!isIdentityAt(i)) {
+                acting_qubits.push_back(qbs_order[old->acting_qubits[j]]);
             } else {
-                acting_qubits.push_back(list_gates[i]->acting_qubits[j]);
+                acting_qubits.push_back(old->acting_qubits[j]);
             }
         }
-        std::shared_ptr<Gate> gate = Gate::findCorrectGate(ch->all_gates, list_gates[i]->name, acting_qubits);
+        std::shared_ptr<Gate> gate = Gate::findCorrectGate(ch->all_gates, old->name, acting_qubits);
         placeGateAt(i, gate);
 
     }
@@ -537,10 +719,10 @@ void GateCircuit::changeQubits(std::vector<int> qbs_order) {
  */
 void GateCircuit::invert() {
     stopMatrixComputer();
-    std::vector<std::shared_ptr<Gate>> new_list_gates;
+    std::vector<GateId> new_list_gates;
     for (int i = nbElements() - 1; i >= 0; i--){
-        std::shared_ptr<Gate> inverted_gate = ch->invertGate(list_gates[i]);
-        new_list_gates.push_back(inverted_gate);
+        std::shared_ptr<Gate> inverted_gate = ch->invertGate(getGate(i));
+        new_list_gates.push_back(inverted_gate->id);
     }
     for (int i = 0; i < nbElements(); i++) {
         placeGateAt(i, new_list_gates[i]);
@@ -557,7 +739,7 @@ void GateCircuit::invert() {
  */
 void GateCircuit::rotate() {
     stopMatrixComputer();
-    std::vector<std::shared_ptr<Gate>> list_gates_copy = list_gates;
+    std::vector<GateId> list_gates_copy = list_gates;
     for (int i = nbElements() - 1; i >= 0; i--){
         placeGateAt(nbElements() - 1 - i, list_gates_copy[i]);
     }
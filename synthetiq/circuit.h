@@ -13,33 +13,42 @@
 #include "gate.h"
 #include "circuithelper.h"
 #include "matrix_computer.h"
+#include "fixed_matrix_computer.h"
 
 class GateCircuit {
     public:
         GateCircuit(CircuitHelper& ch, MatrixComputerType matrix_computer_type=Binary);
         GateCircuit(int nb_gates, int nb_q, CircuitHelper& ch, MatrixComputerType matrix_computer_type=Binary);
         GateCircuit(GateCircuit const& other);
-        GateCircuit(std::vector<std::shared_ptr<Gate>> gates, int nb_q, CircuitHelper& ch, MatrixComputerType matrix_computer_type=Binary);
+        GateCircuit(GateCircuit const& other, const std::vector<GateId>& gates);
+        GateCircuit(std::vector<GateId> gates, int nb_q, CircuitHelper& ch, MatrixComputerType matrix_computer_type=Binary);
         ~GateCircuit() {}
         int nbElements(); //must return total possible number of gates (including Id)(if representation changes and we don't have a fixed number of gates anymore, beware of PerfCost computation, may not be normalized anymore)
         int performanceNormalizationCst();
         void readGateFromQasmInputLine(std::string line);
         void readFromInput(std::string filename); //from cin
+        void readFromQasm(std::istream& stream);
         void readFromInputNonQuasm(std::string filename, int nb_l_to_ignore, int nb_qbs_in_cirs); //from cin
         void readFromIfStream(std::ifstream& file);
         std::string print_qasm();
         void calculateCost();
-        void updateCost(std::shared_ptr<Gate> new_gate, std::shared_ptr<Gate> old_gate);
+        void updateCost(GateId new_gate, GateId old_gate);
         double getCost();
         int getNbNonIdGates();
         Eigen::MatrixXcd toMatrix();
-        const std::vector<std::shared_ptr<Gate>> getGates();
+        const std::complex<double>* matrixData();
+        const std::vector<GateId>& getGateIds();
+        const std::shared_ptr<Gate>& getGate(int position);
+        bool isIdentityAt(int position);
+        void gateProbabilities(std::vector<double>& probabilities, double proportional_prob=1.0, double proba_id=0.2, double proba_name=1.0);
+        GateId drawGate(RandomHelper& rh, double proportional_prob=1.0, double proba_id=0.2, double proba_name=1.0);
         bool mutate(RandomHelper& rh, double proportional_prob=1.0, double proba_id=0.2, double proba_name=1.0);
         bool mutate(RandomHelper& rh, int position, double proportional_prob=1.0, double proba_id=0.2, double proba_name=1.0);
 
         void undoMutation();
         void applyMutationAgain(GateCircuit& other);
-        void placeGateAt(int position, std::shared_ptr<Gate> gate); //replaces gate at pos with new gate, assumes qbs of size 2
+        void placeGateAt(int position, GateId gate); //replaces gate at pos with new gate, assumes qbs of size 2
+        void placeGateAt(int position, const std::shared_ptr<Gate>& gate);
         void changeQubits(std::vector<int> qbs_order);
         void stopMatrixComputer();
         void startMatrixComputer();
@@ -49,22 +58,27 @@ class GateCircuit {
         void invert();
         void rotate();
         void initializeMatrixComputer();
+        void restrictToColumns(std::shared_ptr<const std::vector<int>> columns);
         std::shared_ptr<CircuitHelper> getCircuitHelper();
         std::shared_ptr<GateCircuit> clone();
+        std::shared_ptr<GateCircuit> clone(const std::vector<GateId>& gates);
+        void copyFrom(GateCircuit const& other);
 
         int nb_qbs;
-        std::shared_ptr<Gate> old_gate;
-        std::shared_ptr<Gate> new_gate;
+        GateId old_gate;
+        GateId new_gate;
         int pos_mutation;
 
     private:
-        std::vector<std::shared_ptr<Gate>> list_gates;
+        std::vector<GateId> list_gates; // ids of the gates in the gate table of ch
         std::shared_ptr<MatrixComputer> matrixComputer;
         std::shared_ptr<CircuitHelper> ch;
         int nb_non_id_gates = 0;
         double cost = 0;
         MatrixComputerType matrix_computer_type;
+        std::shared_ptr<const std::vector<int>> slab_columns; // columns computed by a SlabMatrixComputer
         bool calculating_matrix_computer = true;
+        bool can_rollback = false; // whether the last placeGateAt updated the matrix computer, so that undoMutation can roll it back
 };
 
 #endif
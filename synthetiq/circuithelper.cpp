@@ -1,5 +1,6 @@
 #include "circuithelper.h"
 #include "utils.h"
+#include "compiled_gates.h"
 #include <sstream>
 #include <string>
 #include <iterator>
@@ -13,26 +14,45 @@
  * @return True if the gate is already present, false otherwise.
  */
 bool CircuitHelper::isAlreadyPresent(std::string name, std::vector<int> acting_qubits) {
-    std::shared_ptr<Gate> gate = Gate::findCorrectGate(readable_gates, name, acting_qubits);
-    if (gate) {
-        return true;
+    return present_gates.count(std::make_pair(name, acting_qubits)) > 0;
+}
+
+/**
+ * Adds a gate to the readable gates, which form the gate table of the circuits: the id of a gate is its index in this table.
+ * 
+ * @param gate The gate to add.
+ * @throws std::length_error If the table does not fit in the range of gate ids.
+ */
+void CircuitHelper::addReadableGate(std::shared_ptr<Gate> gate) {
+    if (readable_gates.size() > std::numeric_limits<GateId>::max()) {
+        throw std::length_error("Too many gates in the gate set for " + std::to_string(nb_qbs) + " qubits.");
     }
-    return false;
+    gate->id = readable_gates.size();
+    readable_gates.push_back(gate);
+    gate_flags.push_back({gate->cost, gate->name == id_gate->name});
+    present_gates.insert(std::make_pair(gate->name, gate->acting_qubits));
 }
 
 /**
- * @brief Constructs a CircuitHelper object.
+ * Constructs a CircuitHelper object. If a compiled gate set produced by compile_gates matches the gate folders and the number of qubits,
+ * the gates are loaded from it, otherwise they are read from the gate folders and placed on all qubit combinations.
  * 
  * @param nb_qbs The number of qubits in the circuit.
  * @param basic_gate_folder The folder path containing the basic gate files.
  * @param composite_gate_folder The folder path containing the composite gate files.
  * @param read_gate_folder The folder path containing the read gate files.
+ * @param use_compiled Whether to load a matching compiled gate set if there is one.
  */
-CircuitHelper::CircuitHelper(int nb_qbs, std::string basic_gate_folder, std::string composite_gate_folder, std::string read_gate_folder) : nb_qbs(nb_qbs), 
+CircuitHelper::CircuitHelper(int nb_qbs, std::string basic_gate_folder, std::string composite_gate_folder, std::string read_gate_folder, bool use_compiled) : nb_qbs(nb_qbs), 
     basic_gate_folder(basic_gate_folder), composite_gate_folder(composite_gate_folder), read_gate_folder(read_gate_folder) {
-    id_gate = std::make_shared<BasicGate>(BasicGate("id", Eigen::MatrixXcd::Identity(pow(2, nb_qbs), pow(2, nb_qbs)), {0}, 0.0));
+    if (use_compiled && loadCompiled(compiledPath())) {
+        loaded_compiled = true;
+        return;
+    }
+    id_gate = std::make_shared<BasicGate>(BasicGate("id", Eigen::MatrixXcd::Identity(1, 1), {}, {0}, 0.0, nb_qbs));
+    id_gate->detectKind();
     all_gates.push_back(id_gate);
-    readable_gates.push_back(id_gate);
+    addReadableGate(id_gate);
     max_cost_basic = 0;
     if (std::filesystem::is_directory(basic_gate_folder)) {
         readBasicGateFolder(basic_gate_folder);
@@ -48,6 +68,65 @@ CircuitHelper::CircuitHelper(int nb_qbs, std::string basic_gate_folder, std::str
     }
 }
 
+/**
+ * Returns the CircuitHelper for the given number of qubits and gate folders, which is built the first time it is requested and then shared
+ * by all callers of the process. Building a CircuitHelper reads the gate files and places every gate on all qubit combinations, which is
+ * done once instead of once per thread and run. Concurrent callers for the same key wait for the first one to finish building, while callers
+ * for other keys build theirs at the same time: the cache is only locked to look up and insert keys, not while building.
+ *
+ * @param nb_qbs The number of qubits in the circuit.
+ * @param basic_gate_folder The folder path containing the basic gate files.
+ * @param composite_gate_folder The folder path containing the composite gate files.
+ * @param read_gate_folder The folder path containing the read gate files.
+ * @param replica The copy to return, e.g. the NUMA node of the caller. Each copy is built by its first caller, and thus in the memory of its node.
+ * @return A shared pointer to the CircuitHelper, which must not be modified.
+ * @throws std::exception The exception of the constructor of the CircuitHelper, for its first caller and the callers waiting for it. The key is
+ * then removed from the cache, so that a later caller builds it again.
+ */
+std::shared_ptr<CircuitHelper> CircuitHelper::shared(int nb_qbs, std::string basic_gate_folder, std::string composite_gate_folder, std::string read_gate_folder, int replica) {
+    typedef std::tuple<int, std::string, std::string, std::string, int> Key;
+    static std::mutex cache_mutex;
+    static std::map<Key, std::shared_future<std::shared_ptr<CircuitHelper>>> cache;
+    Key key = std::make_tuple(nb_qbs, basic_gate_folder, composite_gate_folder, read_gate_folder, replica);
+    std::promise<std::shared_ptr<CircuitHelper>> promise;
+    std::shared_future<std::shared_ptr<CircuitHelper>> helper;
+    bool builds = false;
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        std::map<Key, std::shared_future<std::shared_ptr<CircuitHelper>>>::iterator cached = cache.find(key);
+        if (cached == cache.end()) {
+            helper = promise.get_future().share();
+            cache[key] = helper;
+            builds = true;
+        } else {
+            helper = cached->second;
+        }
+    }
+    if (builds) {
+        try {
+            promise.set_value(std::make_shared<CircuitHelper>(nb_qbs, basic_gate_folder, composite_gate_folder, read_gate_folder));
+        } catch (...) {
+            promise.set_exception(std::current_exception());
+            std::lock_guard<std::mutex> lock(cache_mutex);
+            cache.erase(key);
+        }
+    }
+    return helper.get();
+}
+
+/**
+ * @brief Returns a shared pointer to this CircuitHelper if it is owned by one, for instance if it comes from shared, and a shared copy otherwise.
+ *
+ * @return A shared pointer to this CircuitHelper or to a copy of it.
+ */
+std::shared_ptr<CircuitHelper> CircuitHelper::share() {
+    std::shared_ptr<CircuitHelper> owner = weak_from_this().lock();
+    if (owner != nullptr) {
+        return owner;
+    }
+    return std::make_shared<CircuitHelper>(*this);
+}
+
 /**
  * Reads the basic gate folder and populates the basic_gates vector with the gates found.
  * 
@@ -60,8 +139,6 @@ void CircuitHelper::readBasicGateFolder(std::string folder) {
             continue;
         }
 
-        Eigen::MatrixXcd resized_matrix = Utils::increaseQubits(gate.matrix, nb_qbs);
-        BasicGate gate_correct_qbs = BasicGate(gate.name, resized_matrix, gate.acting_qubits, gate.cost);
         if (gate.cost > max_cost_basic) {
             max_cost_basic = gate.cost;
         }
@@ -72,17 +149,19 @@ void CircuitHelper::readBasicGateFolder(std::string folder) {
         basic_gates_by_name.push_back(std::vector<std::shared_ptr<Gate>>());
         do {
             std::vector<int> new_acting_qbs = {};
-            for (int i = 0; i < gate_correct_qbs.acting_qubits.size(); i++) {
-                new_acting_qbs.push_back(qbs[gate_correct_qbs.acting_qubits[i]]);
+            for (int i = 0; i < gate.acting_qubits.size(); i++) {
+                new_acting_qbs.push_back(qbs[gate.acting_qubits[i]]);
             }
-            Eigen::MatrixXcd new_matrix = Utils::changeQubits(gate_correct_qbs.matrix, qbs);
-            if (!isAlreadyPresent(gate_correct_qbs.name, new_acting_qbs)) {
-                BasicGate new_gate = BasicGate(gate_correct_qbs.name, new_matrix, new_acting_qbs, gate_correct_qbs.cost);
+            if (!isAlreadyPresent(gate.name, new_acting_qbs)) {
+                // the gate file defines the gate on the first qubits, which are moved to qbs[0], qbs[1], ...
+                std::vector<int> local_qbs = std::vector<int>(qbs.begin(), qbs.begin() + gate.nb_qbs);
+                BasicGate new_gate = BasicGate(gate.name, gate.local_matrix, local_qbs, new_acting_qbs, gate.cost, nb_qbs);
+                new_gate.detectKind();
                 std::shared_ptr<Gate> gate_ptr = std::make_shared<BasicGate>(new_gate);
                 basic_gates_by_name[basic_gates_by_name.size() - 1].push_back(gate_ptr);
                 basic_gates.push_back(gate_ptr);
                 all_gates.push_back(gate_ptr);
-                readable_gates.push_back(gate_ptr);
+                addReadableGate(gate_ptr);
             }
         } while (std::next_permutation(qbs.begin(), qbs.end()));
     }
@@ -119,6 +198,7 @@ void CircuitHelper::readCompositeGateFolder(std::string folder, bool read_folder
             if (!isAlreadyPresent(gate.name, new_acting_qbs)) {
                 CompositeGate new_gate = CompositeGate(gate);
                 new_gate.changeQubitsDecomposition(qbs, basic_gates);
+                new_gate.detectKind();
                 std::shared_ptr<Gate> gate_ptr = std::make_shared<CompositeGate>(new_gate);
                 
                 if (!read_folder) {
@@ -126,7 +206,7 @@ void CircuitHelper::readCompositeGateFolder(std::string folder, bool read_folder
                     composite_gates.push_back(gate_ptr);
                     all_gates.push_back(gate_ptr);
                 }
-                readable_gates.push_back(gate_ptr);
+                addReadableGate(gate_ptr);
             }
         } while (std::next_permutation(qbs.begin(), qbs.end()));
     }
@@ -138,10 +218,185 @@ void CircuitHelper::readCompositeGateFolder(std::string folder, bool read_folder
  * @param gate The gate to invert.
  */
 std::shared_ptr<Gate> CircuitHelper::invertGate(std::shared_ptr<Gate> gate) {
+    Eigen::MatrixXcd conjugate_matrix = gate->getMatrix().conjugate();
     for (std::shared_ptr<Gate> other_gate : all_gates) {
-        if (gate->matrix == other_gate->matrix.conjugate()) {
+        if (other_gate->equalsMatrix(conjugate_matrix, 0.0)) {
             return other_gate;
         }
     }
     return nullptr;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Marks the gates of the gate table with one of the given names.
+ * 
+ * @param gate_names The names of the gates to mark.
+ * @return A vector indexed by gate id, true for the gates with one of the given names.
+ */
+std::vector<bool> CircuitHelper::gatesNamed(std::vector<std::string> gate_names) {
+    std::vector<bool> named(readable_gates.size(), false);
+    for (int i = 0; i < readable_gates.size(); i++) {
+        named[i] = std::find(gate_names.begin(), gate_names.end(), readable_gates[i]->name) != gate_names.end();
+    }
+    return named;
+}
+
+/**
+ * Returns the path of the compiled gate set matching the gate folders and the number of qubits of this CircuitHelper. Compiled gate sets
+ * are stored in a folder named compiled next to the basic gate folder, and their file name contains a hash of the gate files, so that
+ * editing a gate file makes the compiled gate set stale instead of wrong.
+ *
+ * @return The path of the compiled gate set, which may not exist.
+ */
+std::string CircuitHelper::compiledPath() {
+    std::filesystem::path basic_path = std::filesystem::path(basic_gate_folder).lexically_normal();
+    if (!basic_path.has_filename()) {
+        basic_path = basic_path.parent_path();
+    }
+    uint64_t key = compiledGatesKey(nb_qbs, {basic_gate_folder, composite_gate_folder, read_gate_folder});
+    std::stringstream name;
+    name << "gates_" << nb_qbs << "_" << std::hex << key << ".bin";
+    return (basic_path.parent_path() / "compiled" / name.str()).string();
+}
+
+/**
+ * Writes the gate table to a compiled gate set, which can be loaded instead of reading the gate folders. Every gate is stored on its
+ * qubits with its local matrix, and the decompositions of composite gates are stored as gate ids.
+ *
+ * @param path The path of the compiled gate set, usually compiledPath(). The file is only replaced once it is written in full.
+ * @return True if the compiled gate set was written, false if the file cannot be written, in which case a previous file is left in place.
+ * @throws std::runtime_error If a decomposition uses a gate outside the gate table.
+ */
+bool CircuitHelper::saveCompiled(std::string path) {
+    std::map<Gate*, std::pair<int, int>> groups; // list (1 for basic, 2 for composite) and group of each gate of all_gates
+    for (int g = 0; g < basic_gates_by_name.size(); g++) {
+        for (std::shared_ptr<Gate> gate : basic_gates_by_name[g]) {
+            groups[gate.get()] = std::make_pair(1, g);
+        }
+    }
+    for (int g = 0; g < composite_gates_by_name.size(); g++) {
+        for (std::shared_ptr<Gate> gate : composite_gates_by_name[g]) {
+            groups[gate.get()] = std::make_pair(2, g);
+        }
+    }
+
+    CompiledGatesWriter writer(path);
+    writer.writeInt(compiled_gates_magic);
+    writer.writeInt(compiled_gates_version);
+    writer.writeInt(compiledGatesKey(nb_qbs, {basic_gate_folder, composite_gate_folder, read_gate_folder}));
+    writer.writeInt(nb_qbs);
+    writer.writeDouble(max_cost_basic);
+    writer.writeDouble(max_cost_all);
+    writer.writeInt(basic_gates_by_name.size());
+    writer.writeInt(composite_gates_by_name.size());
+    writer.writeInt(readable_gates.size());
+    for (std::shared_ptr<Gate> gate : readable_gates) {
+        // list 0 is for the gates of the read folder, which are not in all_gates, and list 3 for the identity
+        std::pair<int, int> group = gate == id_gate ? std::make_pair(3, 0) : std::make_pair(0, 0);
+        if (groups.count(gate.get()) > 0) {
+            group = groups[gate.get()];
+        }
+        writer.writeInt(gate->isBasicGate() ? 0 : 1);
+        writer.writeInt(group.first);
+        writer.writeInt(group.second);
+        writer.writeString(gate->name);
+        writer.writeDouble(gate->cost);
+        writer.writeInt(gate->nb_qbs);
+        writer.writeInts(gate->acting_qubits);
+        writer.writeInts(gate->local_qubits);
+        writer.writeComplex(gate->local_matrix.data(), gate->local_matrix.size());
+        std::vector<int> decomposition = {};
+        if (!gate->isBasicGate()) {
+            for (std::shared_ptr<Gate> decomp_gate : std::static_pointer_cast<CompositeGate>(gate)->decomposition) {
+                if (decomp_gate->id >= readable_gates.size() || readable_gates[decomp_gate->id] != decomp_gate) {
+                    throw std::runtime_error("Gate in decomposition of " + gate->name + " is not in the gate table.");
+                }
+                decomposition.push_back(decomp_gate->id);
+            }
+        }
+        writer.writeInts(decomposition);
+    }
+    return writer.close();
+}
+
+/**
+ * Loads the gate table from a compiled gate set written by saveCompiled. The file is memory-mapped and checked against the gate folders
+ * and the number of qubits; if it is missing, stale or truncated, nothing is loaded.
+ *
+ * @param path The path of the compiled gate set.
+ * @return True if the gate table was loaded.
+ */
+bool CircuitHelper::loadCompiled(std::string path) {
+    CompiledGatesReader reader(path);
+    if (!reader.isOpen()) {
+        return false;
+    }
+    if ((uint64_t) reader.readInt() != compiled_gates_magic || reader.readInt() != compiled_gates_version
+        || (uint64_t) reader.readInt() != compiledGatesKey(nb_qbs, {basic_gate_folder, composite_gate_folder, read_gate_folder}) || reader.readInt() != nb_qbs) {
+        return false;
+    }
+    CircuitHelper loaded = CircuitHelper(*this);
+    loaded.max_cost_basic = reader.readDouble();
+    loaded.max_cost_all = reader.readDouble();
+    int n_basic_groups = reader.readInt();
+    int n_composite_groups = reader.readInt();
+    int n_gates = reader.readInt();
+    if (reader.failed() || n_basic_groups < 0 || n_composite_groups < 0 || n_gates < 1) {
+        return false;
+    }
+    loaded.basic_gates_by_name.resize(n_basic_groups);
+    loaded.composite_gates_by_name.resize(n_composite_groups);
+    for (int i = 0; i < n_gates && !reader.failed(); i++) {
+        bool basic = reader.readInt() == 0;
+        int list = reader.readInt();
+        int group = reader.readInt();
+        std::string name = reader.readString();
+        double cost = reader.readDouble();
+        int gate_nb_qbs = reader.readInt();
+        std::vector<int> acting_qubits = reader.readInts();
+        std::vector<int> local_qubits = reader.readInts();
+        if (reader.failed() || gate_nb_qbs != nb_qbs || local_qubits.size() > nb_qbs || (i == 0) != (list == 3)) {
+            return false;
+        }
+        int local_size = 1 << local_qubits.size();
+        Eigen::MatrixXcd local_matrix(local_size, local_size);
+        reader.readComplex(local_matrix.data(), local_matrix.size());
+        std::vector<int> decomposition_ids = reader.readInts();
+
+        std::shared_ptr<Gate> gate;
+        if (basic) {
+            gate = std::make_shared<BasicGate>(name, local_matrix, local_qubits, acting_qubits, cost, nb_qbs);
+        } else {
+            std::vector<std::shared_ptr<Gate>> decomposition = {};
+            for (int id : decomposition_ids) {
+                if (id < 0 || id >= i) {
+                    return false;
+                }
+                decomposition.push_back(loaded.readable_gates[id]);
+            }
+            gate = std::make_shared<CompositeGate>(name, local_matrix, local_qubits, acting_qubits, cost, nb_qbs, decomposition);
+        }
+        gate->detectKind();
+
+        if (list == 1 && group >= 0 && group < n_basic_groups) {
+            loaded.basic_gates_by_name[group].push_back(gate);
+            loaded.basic_gates.push_back(gate);
+            loaded.all_gates.push_back(gate);
+        } else if (list == 2 && group >= 0 && group < n_composite_groups) {
+            loaded.composite_gates_by_name[group].push_back(gate);
+            loaded.composite_gates.push_back(gate);
+            loaded.all_gates.push_back(gate);
+        } else if (list == 3) {
+            loaded.id_gate = gate;
+            loaded.all_gates.push_back(gate);
+        } else if (list != 0) {
+            return false;
+        }
+        loaded.addReadableGate(gate);
+    }
+    if (reader.failed()) {
+        return false;
+    }
+    *this = loaded;
+    return true;
+}
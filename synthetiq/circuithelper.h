@@ -9,12 +9,26 @@
 #include <filesystem>
 #include <regex>
 #include <limits>
+#include <memory>
+#include <mutex>
+#include <future>
+#include <map>
+#include <tuple>
+#include <set>
 #include "randomhelper.h"
 #include "gate.h"
 
-class CircuitHelper {
+struct GateFlags {
+    double cost;
+    bool is_identity;
+};
+
+class CircuitHelper : public std::enable_shared_from_this<CircuitHelper> {
+    // a CircuitHelper is not modified after construction, so that one object can be shared by all circuits and threads, see shared
     public:
-        CircuitHelper(int nb_qbs = 1, std::string basic_gate_folder="data/gates/CliffordT", std::string composite_gate_folder="data/gates/composite_gates", std::string read_gate_folder="data/gates/read_gates");
+        CircuitHelper(int nb_qbs = 1, std::string basic_gate_folder="data/gates/CliffordT", std::string composite_gate_folder="data/gates/composite_gates", std::string read_gate_folder="data/gates/read_gates", bool use_compiled=true);
+        static std::shared_ptr<CircuitHelper> shared(int nb_qbs = 1, std::string basic_gate_folder="data/gates/CliffordT", std::string composite_gate_folder="data/gates/composite_gates", std::string read_gate_folder="data/gates/read_gates", int replica=0);
+        std::shared_ptr<CircuitHelper> share();
         std::vector<std::shared_ptr<Gate>> all_gates;
         std::vector<std::shared_ptr<Gate>> readable_gates;
         std::vector<std::shared_ptr<Gate>> basic_gates;
@@ -22,15 +36,23 @@ class CircuitHelper {
         std::vector<std::vector<std::shared_ptr<Gate>>> basic_gates_by_name;
         std::vector<std::vector<std::shared_ptr<Gate>>> composite_gates_by_name;
         std::shared_ptr<Gate> id_gate;
+        std::vector<GateFlags> gate_flags; // flags of each gate in readable_gates, indexed by gate id
         std::shared_ptr<Gate> invertGate(std::shared_ptr<Gate> gate);
+        std::vector<bool> gatesNamed(std::vector<std::string> gate_names);
+        std::string compiledPath();
+        bool saveCompiled(std::string path);
         std::string basic_gate_folder;
         std::string composite_gate_folder;
         std::string read_gate_folder;
         int nb_qbs;
-        double max_cost_basic;
-        double max_cost_all;
+        double max_cost_basic = 0;
+        double max_cost_all = 0;
+        bool loaded_compiled = false; // true if the gates were loaded from a compiled gate set instead of the gate folders
     private:
+        std::set<std::pair<std::string, std::vector<int>>> present_gates; // name and acting qubits of each readable gate
+        bool loadCompiled(std::string path);
         bool isAlreadyPresent(std::string name, std::vector<int> acting_qubits);
+        void addReadableGate(std::shared_ptr<Gate> gate);
         void readBasicGateFolder(std::string folder);
         void readCompositeGateFolder(std::string folder, bool read_folder=false);
 };
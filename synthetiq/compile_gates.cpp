@@ -0,0 +1,53 @@
+#include "circuithelper.h"
+
+#include <iostream>
+#include <string>
+#include <filesystem>
+#include <chrono>
+
+/**
+ * @brief Compiles a gate set for every number of qubits up to the given one, so that main can load it instead of building it.
+ *
+ * Usage: compile_gates <max qubits> [--gate-set <folder>] [--composite-gates <folder>] [--absolute-gates]
+ * The gate folders are interpreted as in main, and the compiled gate sets are written to the folder compiled next to the gate set.
+ *
+ * @param argc The number of command-line arguments.
+ * @param argv An array of command-line arguments.
+ * @return int The exit status of the program.
+ */
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <max qubits> [--gate-set <folder>] [--composite-gates <folder>] [--absolute-gates]" << std::endl;
+        return 1;
+    }
+    int max_qbs = std::stoi(argv[1]);
+    std::string base_gate_folder = "data/gates/";
+    std::string gate_set = "CliffordT";
+    std::string composite_gate_folder = "composite_gates";
+    for (int arg = 2; arg < argc; arg++) {
+        if ((std::string(argv[arg]) == "--gate-set" || std::string(argv[arg]) == "-gs") && arg + 1 < argc) {
+            gate_set = argv[++arg];
+        } else if ((std::string(argv[arg]) == "--composite-gates" || std::string(argv[arg]) == "-cg") && arg + 1 < argc) {
+            composite_gate_folder = argv[++arg];
+        } else if (std::string(argv[arg]) == "--absolute-gates") {
+            base_gate_folder = "";
+        } else {
+            std::cerr << "Unknown argument: " << argv[arg] << std::endl;
+            return 1;
+        }
+    }
+
+    for (int nb_qbs = 1; nb_qbs <= max_qbs; nb_qbs++) {
+        auto start = std::chrono::steady_clock::now();
+        CircuitHelper ch = CircuitHelper(nb_qbs, base_gate_folder + gate_set, base_gate_folder + composite_gate_folder, "data/gates/read_gates", false);
+        std::string path = ch.compiledPath();
+        std::filesystem::create_directories(std::filesystem::path(path).parent_path());
+        if (!ch.saveCompiled(path)) {
+            std::cerr << "Cannot write compiled gate set " << path << std::endl;
+            return 1;
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << nb_qbs << " qubits: " << ch.readable_gates.size() << " gates in " << seconds << "s, written to " << path << std::endl;
+    }
+    return 0;
+}
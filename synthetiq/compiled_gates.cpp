@@ -0,0 +1,284 @@
+#include "compiled_gates.h"
+#include <filesystem>
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/**
+ * @brief Adds the given bytes to a 64-bit FNV-1a hash.
+ *
+ * @param hash The hash to update.
+ * @param bytes The bytes to add.
+ * @param size The number of bytes.
+ */
+void hashBytes(uint64_t& hash, const void* bytes, size_t size) {
+    const unsigned char* values = static_cast<const unsigned char*>(bytes);
+    for (size_t i = 0; i < size; i++) {
+        hash ^= values[i];
+        hash *= 0x100000001b3;
+    }
+}
+
+/**
+ * Calculates the key of a compiled gate set, which changes whenever a gate file is added, removed, renamed or modified, or when the number of
+ * qubits or the format version changes. The files of each folder are hashed in the order of their names.
+ *
+ * @param nb_qbs The number of qubits of the gate set.
+ * @param folders The gate folders the gate set is built from, in the order in which they are read. Missing folders are skipped.
+ * @return The key.
+ */
+uint64_t compiledGatesKey(int nb_qbs, const std::vector<std::string>& folders) {
+    uint64_t hash = 0xcbf29ce484222325;
+    hashBytes(hash, &compiled_gates_version, sizeof(compiled_gates_version));
+    hashBytes(hash, &nb_qbs, sizeof(nb_qbs));
+    for (int f = 0; f < folders.size(); f++) {
+        hashBytes(hash, &f, sizeof(f));
+        if (!std::filesystem::is_directory(folders[f])) {
+            continue;
+        }
+        std::vector<std::filesystem::path> files = {};
+        for (const auto & file : std::filesystem::directory_iterator(folders[f])) {
+            if (file.is_regular_file()) {
+                files.push_back(file.path());
+            }
+        }
+        std::sort(files.begin(), files.end());
+        for (const std::filesystem::path& file : files) {
+            std::string name = file.filename().string();
+            hashBytes(hash, name.data(), name.size() + 1);
+            std::ifstream stream(file, std::ios::binary);
+            std::string contents((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+            uint64_t length = contents.size();
+            hashBytes(hash, &length, sizeof(length));
+            hashBytes(hash, contents.data(), contents.size());
+        }
+    }
+    return hash;
+}
+
+/**
+ * @brief Constructs a CompiledGatesWriter that writes to a temporary file next to the given file, which replaces it on close.
+ *
+ * @param path The path of the file.
+ */
+CompiledGatesWriter::CompiledGatesWriter(std::string path) : path(path) {
+    temp_path = path + "." + std::to_string(getpid()) + ".tmp";
+    file.open(temp_path, std::ios::binary | std::ios::trunc);
+}
+
+/**
+ * @brief Removes the temporary file if the writer was not closed, e.g. after an exception, leaving the file at the path untouched.
+ */
+CompiledGatesWriter::~CompiledGatesWriter() {
+    if (!closed) {
+        file.close();
+        std::error_code error;
+        std::filesystem::remove(temp_path, error);
+    }
+}
+
+/**
+ * @brief Writes an integer as 8 bytes.
+ *
+ * @param value The value to write.
+ */
+void CompiledGatesWriter::writeInt(int64_t value) {
+    file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+/**
+ * @brief Writes a double.
+ *
+ * @param value The value to write.
+ */
+void CompiledGatesWriter::writeDouble(double value) {
+    file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+/**
+ * @brief Writes a string as its length followed by its characters.
+ *
+ * @param value The value to write.
+ */
+void CompiledGatesWriter::writeString(const std::string& value) {
+    writeInt(value.size());
+    file.write(value.data(), value.size());
+}
+
+/**
+ * @brief Writes a vector of integers as its length followed by its values.
+ *
+ * @param values The values to write.
+ */
+void CompiledGatesWriter::writeInts(const std::vector<int>& values) {
+    writeInt(values.size());
+    for (int value : values) {
+        writeInt(value);
+    }
+}
+
+/**
+ * @brief Writes complex values, whose number is not stored.
+ *
+ * @param values The values to write.
+ * @param size The number of values.
+ */
+void CompiledGatesWriter::writeComplex(const std::complex<double>* values, int size) {
+    file.write(reinterpret_cast<const char*>(values), size * sizeof(std::complex<double>));
+}
+
+/**
+ * @brief Closes the temporary file and renames it to the path of the writer. The rename replaces the previous file at once, so a process that
+ * has mapped it keeps reading the previous contents. If a value could not be written, the temporary file is removed instead.
+ *
+ * @return True if all values were written and the file is in place.
+ */
+bool CompiledGatesWriter::close() {
+    closed = true;
+    file.close();
+    std::error_code error;
+    if (!file.fail()) {
+        std::filesystem::rename(temp_path, path, error);
+        if (!error) {
+            return true;
+        }
+    }
+    std::filesystem::remove(temp_path, error);
+    return false;
+}
+
+/**
+ * @brief Constructs a CompiledGatesReader by mapping the given file into memory. If the file cannot be opened, the reader is not open.
+ *
+ * @param path The path of the file.
+ */
+CompiledGatesReader::CompiledGatesReader(std::string path) {
+    int descriptor = open(path.c_str(), O_RDONLY);
+    if (descriptor < 0) {
+        return;
+    }
+    struct stat status;
+    if (fstat(descriptor, &status) == 0 && status.st_size > 0) {
+        void* mapping = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        if (mapping != MAP_FAILED) {
+            data = static_cast<const char*>(mapping);
+            size = status.st_size;
+            madvise(mapping, size, MADV_SEQUENTIAL);
+        }
+    }
+    ::close(descriptor);
+}
+
+/**
+ * @brief Unmaps the file.
+ */
+CompiledGatesReader::~CompiledGatesReader() {
+    if (data != nullptr) {
+        munmap(const_cast<char*>(data), size);
+    }
+}
+
+/**
+ * @brief Checks whether the file was mapped.
+ *
+ * @return True if the file is open.
+ */
+bool CompiledGatesReader::isOpen() {
+    return data != nullptr;
+}
+
+/**
+ * @brief Checks whether a read went past the end of the file.
+ *
+ * @return True if a read failed.
+ */
+bool CompiledGatesReader::failed() {
+    return has_failed;
+}
+
+/**
+ * @brief Copies the next bytes of the file.
+ *
+ * @param destination Where to copy the bytes, set to zero if there are not enough bytes left.
+ * @param length The number of bytes.
+ * @return True if the bytes were read.
+ */
+bool CompiledGatesReader::readBytes(void* destination, size_t length) {
+    if (has_failed || length > size - offset) {
+        has_failed = true;
+        std::memset(destination, 0, length);
+        return false;
+    }
+    std::memcpy(destination, data + offset, length);
+    offset += length;
+    return true;
+}
+
+/**
+ * @brief Reads an integer written by CompiledGatesWriter::writeInt.
+ *
+ * @return The value.
+ */
+int64_t CompiledGatesReader::readInt() {
+    int64_t value;
+    readBytes(&value, sizeof(value));
+    return value;
+}
+
+/**
+ * @brief Reads a double.
+ *
+ * @return The value.
+ */
+double CompiledGatesReader::readDouble() {
+    double value;
+    readBytes(&value, sizeof(value));
+    return value;
+}
+
+/**
+ * @brief Reads a string written by CompiledGatesWriter::writeString.
+ *
+ * @return The value, empty if the read failed.
+ */
+std::string CompiledGatesReader::readString() {
+    int64_t length = readInt();
+    if (has_failed || length < 0 || length > size - offset) {
+        has_failed = true;
+        return "";
+    }
+    std::string value(data + offset, length);
+    offset += length;
+    return value;
+}
+
+/**
+ * @brief Reads a vector of integers written by CompiledGatesWriter::writeInts.
+ *
+ * @return The values, empty if the read failed.
+ */
+std::vector<int> CompiledGatesReader::readInts() {
+    int64_t length = readInt();
+    if (has_failed || length < 0 || length > (size - offset) / sizeof(int64_t)) {
+        has_failed = true;
+        return {};
+    }
+    std::vector<int> values(length);
+    for (int i = 0; i < length; i++) {
+        values[i] = readInt();
+    }
+    return values;
+}
+
+/**
+ * @brief Reads complex values written by CompiledGatesWriter::writeComplex.
+ *
+ * @param values Where to store the values.
+ * @param length The number of values.
+ */
+void CompiledGatesReader::readComplex(std::complex<double>* values, int length) {
+    readBytes(values, length * sizeof(std::complex<double>));
+}
@@ -0,0 +1,61 @@
+#ifndef DEF_COMPILED_GATES
+#define DEF_COMPILED_GATES
+#include <vector>
+#include <string>
+#include <complex>
+#include <fstream>
+#include <cstdint>
+
+const uint64_t compiled_gates_magic = 0x5345544147515453; // "STQGATES" in little endian
+const uint32_t compiled_gates_version = 1;
+
+void hashBytes(uint64_t& hash, const void* bytes, size_t size);
+uint64_t compiledGatesKey(int nb_qbs, const std::vector<std::string>& folders);
+
+class CompiledGatesWriter {
+    // writes the values in the native byte order, so a file is only meant to be read on the machine that compiled it
+    public:
+        CompiledGatesWriter(std::string path);
+        ~CompiledGatesWriter();
+        CompiledGatesWriter(const CompiledGatesWriter& other) = delete;
+        CompiledGatesWriter& operator=(const CompiledGatesWriter& other) = delete;
+        void writeInt(int64_t value);
+        void writeDouble(double value);
+        void writeString(const std::string& value);
+        void writeInts(const std::vector<int>& values);
+        void writeComplex(const std::complex<double>* values, int size);
+        bool close();
+
+    private:
+        std::string path;
+        std::string temp_path; // the values are written here and renamed to path once complete, so a reader never maps a partial file
+        std::ofstream file;
+        bool closed = false;
+};
+
+class CompiledGatesReader {
+    // reads a file written by CompiledGatesWriter through a read-only memory mapping.
+    // A read past the end of the file returns zero values and marks the reader as failed.
+    public:
+        CompiledGatesReader(std::string path);
+        ~CompiledGatesReader();
+        CompiledGatesReader(const CompiledGatesReader& other) = delete;
+        CompiledGatesReader& operator=(const CompiledGatesReader& other) = delete;
+        bool isOpen();
+        bool failed();
+        int64_t readInt();
+        double readDouble();
+        std::string readString();
+        std::vector<int> readInts();
+        void readComplex(std::complex<double>* values, int size);
+
+    private:
+        bool readBytes(void* destination, size_t size);
+
+        const char* data = nullptr;
+        size_t size = 0;
+        size_t offset = 0;
+        bool has_failed = false;
+};
+
+#endif
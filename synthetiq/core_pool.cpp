@@ -0,0 +1,75 @@
+#include "core_pool.h"
+#include <algorithm>
+
+/**
+ * @brief Constructs a CorePool with all its cores free.
+ *
+ * @param n_cores The number of cores.
+ * @param n_jobs The number of jobs of the batch.
+ */
+CorePool::CorePool(int n_cores, int n_jobs) : n_cores(std::max(1, n_cores)), n_free(std::max(1, n_cores)), n_jobs_left(std::max(1, n_jobs)) {
+}
+
+/**
+ * @brief Waits for a free core and takes it, with as many other free cores as wanted. The wait ends without a core if the cancellation token is
+ * cancelled, e.g. at the deadline of the job. Only one core is waited for, so that a thread that wants several is not starved by the others.
+ *
+ * @param cancellation The cancellation token of the job of the calling thread.
+ * @param n_wanted The number of cores wanted, e.g. the threads of a parallel tempering run.
+ * @return The number of cores taken, between 1 and n_wanted, which must be released, or 0 if cancelled.
+ */
+int CorePool::acquire(CancellationToken& cancellation, int n_wanted) {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (n_free == 0) {
+        if (cancellation.poll()) {
+            return 0;
+        }
+        freed.wait_for(lock, std::chrono::milliseconds(50));
+    }
+    int n_taken = std::max(1, std::min(n_wanted, n_free));
+    n_free -= n_taken;
+    return n_taken;
+}
+
+/**
+ * @brief Gives back cores taken with acquire.
+ *
+ * @param n_taken The number of cores taken.
+ */
+void CorePool::release(int n_taken) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        n_free += n_taken;
+    }
+    freed.notify_all();
+}
+
+/**
+ * @brief Records that a job of the batch is done, whether it succeeded or not, which gives a larger share of the cores to the jobs left.
+ */
+void CorePool::finishJob() {
+    std::lock_guard<std::mutex> lock(mutex);
+    n_jobs_left = std::max(1, n_jobs_left - 1);
+}
+
+/**
+ * @brief Returns the number of threads a job may start now: the cores divided among the jobs that can still run at the same time, rounded up
+ * so that no core is left out. At most as many jobs as cores run at once, and the share never shrinks, so the threads of all jobs stay below
+ * twice the number of cores.
+ *
+ * @return The number of threads of a job.
+ */
+int CorePool::threadsPerJob() {
+    std::lock_guard<std::mutex> lock(mutex);
+    int n_concurrent = std::min(n_cores, n_jobs_left);
+    return (n_cores + n_concurrent - 1) / n_concurrent;
+}
+
+/**
+ * @brief Returns the number of cores of the pool.
+ *
+ * @return The number of cores.
+ */
+int CorePool::getNCores() {
+    return n_cores;
+}
@@ -0,0 +1,28 @@
+#ifndef DEF_CORE_POOL
+#define DEF_CORE_POOL
+
+#include "cancellation.h"
+#include <condition_variable>
+#include <mutex>
+
+class CorePool {
+    // the cores of a batch, shared by the threads of all its jobs: a thread holds a core for each restart it runs and gives it back after,
+    // so that the cores of the jobs that are done go to the threads of the jobs that are still running. The number of threads of a job is its
+    // share of the cores among the jobs left, which only grows as jobs finish, so that the batch never runs more than twice as many threads as cores
+    public:
+        CorePool(int n_cores, int n_jobs);
+        int acquire(CancellationToken& cancellation, int n_wanted=1);
+        void release(int n_taken=1);
+        void finishJob();
+        int threadsPerJob();
+        int getNCores();
+
+    private:
+        int n_cores;
+        int n_free;
+        int n_jobs_left;
+        std::mutex mutex;
+        std::condition_variable freed;
+};
+
+#endif
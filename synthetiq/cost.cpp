@@ -1,5 +1,6 @@
 #include "cost.h"
 #include "utils.h"
+#include "packed_targets.h"
 #include <Eigen/Dense>
 #include <complex>
 
@@ -16,9 +17,24 @@ double EqualityComputer::normalizedEqualityCost(GateCircuit& circ, PartialMatrix
     return 0.0;
 }
 
+/**
+ * Calculates the equality cost from the sums over the cover of the constraint, see coverSums.
+ * This allows callers that obtain the sums in another way to share the cost formula of the computer.
+ *
+ * @param squared_norm The squared norm of the constraint.
+ * @param normalization_cst The number of covered entries.
+ * @param circ_size The squared norm of the covered entries of the circuit matrix.
+ * @param conj The sum of conj(constraint) * circuit over the covered entries.
+ * @return The equality cost.
+ */
+double EqualityComputer::costFromSums(double squared_norm, double normalization_cst, double circ_size, std::complex<double> conj) {
+    return 0.0;
+}
+
 /**
  * Calculates the normalized equality cost for a given gate circuit, qubit independent partial matrix, and circuit helper.
- * The normalized equality cost is the minimum cost among all the partial matrices in the matrix object.
+ * The normalized equality cost is the minimum cost among all the partial matrices in the matrix object, which are evaluated together
+ * by the packed representation of the matrix object.
  *
  * @param circ The gate circuit.
  * @param matrix_obj The qubit independent partial matrix object.
@@ -26,11 +42,92 @@ double EqualityComputer::normalizedEqualityCost(GateCircuit& circ, PartialMatrix
  * @return The normalized equality cost.
  */
 double EqualityComputer::normalizedEqualityCost(GateCircuit& circ, QubitIndependentPartialMatrix& matrix_obj, CircuitHelper& ch) {
-    double cur_norm = INFINITY;
-    for (std::shared_ptr<PartialMatrix> matrix : matrix_obj.matrices) {
-        cur_norm = std::min(cur_norm, normalizedEqualityCost(circ, *matrix, ch));
+    return matrix_obj.getPackedTargets()->minimumCost(circ.matrixData(), *this);
+}
+
+/**
+ * Calculates the normalized equality cost for a given gate circuit as the minimum cost among the given partial matrices of the matrix object only.
+ *
+ * @param circ The gate circuit.
+ * @param matrix_obj The qubit independent partial matrix object.
+ * @param targets The indices of the partial matrices in matrix_obj.matrices to consider.
+ * @return The normalized equality cost.
+ */
+double EqualityComputer::normalizedEqualityCost(GateCircuit& circ, QubitIndependentPartialMatrix& matrix_obj, const std::vector<int>& targets) {
+    return matrix_obj.getPackedTargets()->minimumCost(circ.matrixData(), *this, targets);
+}
+
+/**
+ * Calculates the normalized equality cost for a given gate circuit and every partial matrix of the matrix object.
+ *
+ * @param circ The gate circuit.
+ * @param matrix_obj The qubit independent partial matrix object.
+ * @param costs Is set to the normalized equality cost of each partial matrix in matrix_obj.matrices.
+ */
+void EqualityComputer::normalizedEqualityCosts(GateCircuit& circ, QubitIndependentPartialMatrix& matrix_obj, std::vector<double>& costs) {
+    matrix_obj.getPackedTargets()->costs(circ.matrixData(), *this, costs);
+}
+
+/**
+ * Computes the sums over the cover of the constraint needed by the equality costs: the number of covered entries, the squared norm of the
+ * covered entries of the circuit matrix and the inner product between the constraint and the circuit matrix on the cover.
+ * The matrix of the circuit is read in place and the size is fixed at compile time for small numbers of qubits.
+ *
+ * @param circ The gate circuit.
+ * @param constraint The partial matrix constraint.
+ * @param normalization_cst Is set to the number of covered entries.
+ * @param circ_size Is set to the squared norm of the covered entries of the circuit matrix.
+ * @param conj Is set to the sum of conj(constraint) * circuit over the covered entries.
+ */
+void EqualityComputer::coverSums(GateCircuit& circ, PartialMatrix& constraint, double& normalization_cst, double& circ_size, std::complex<double>& conj) {
+    const std::complex<double>* matr_circ = circ.matrixData();
+    int size = 1 << circ.nb_qbs;
+    switch (circ.nb_qbs) {
+        case 1:
+            coverSums<1>(matr_circ, constraint, size, normalization_cst, circ_size, conj);
+            break;
+        case 2:
+            coverSums<2>(matr_circ, constraint, size, normalization_cst, circ_size, conj);
+            break;
+        case 3:
+            coverSums<3>(matr_circ, constraint, size, normalization_cst, circ_size, conj);
+            break;
+        case 4:
+            coverSums<4>(matr_circ, constraint, size, normalization_cst, circ_size, conj);
+            break;
+        case 5:
+            coverSums<5>(matr_circ, constraint, size, normalization_cst, circ_size, conj);
+            break;
+        case 6:
+            coverSums<6>(matr_circ, constraint, size, normalization_cst, circ_size, conj);
+            break;
+        default:
+            coverSums<0>(matr_circ, constraint, size, normalization_cst, circ_size, conj);
+    }
+}
+
+/**
+ * Computes the sums over the cover of the constraint for a circuit on N qubits, or on any number of qubits if N is 0.
+ *
+ * @param matr_circ The entries of the circuit matrix in column-major order.
+ * @param constraint The partial matrix constraint.
+ * @param size The size of the matrices, only used if N is 0.
+ * @param normalization_cst Is set to the number of covered entries.
+ * @param circ_size Is set to the squared norm of the covered entries of the circuit matrix.
+ * @param conj Is set to the sum of conj(constraint) * circuit over the covered entries.
+ */
+template <int N>
+void EqualityComputer::coverSums(const std::complex<double>* matr_circ, PartialMatrix& constraint, int size, double& normalization_cst, double& circ_size, std::complex<double>& conj) {
+    const int n_entries = N > 0 ? (1 << N) * (1 << N) : size * size;
+    const bool* cover = constraint.cover.data();
+    const std::complex<double>* matr_constraint = constraint.matrix.data();
+    for (int index = 0; index < n_entries; index++) {
+        if (cover[index]) {
+            normalization_cst += 1;
+            circ_size += std::norm(matr_circ[index]);
+            conj += std::conj(matr_constraint[index]) * matr_circ[index];
+        }
     }
-    return cur_norm;
 }
 
 /**
@@ -54,21 +151,23 @@ double ExactEqualityComputer::normalizedEqualityCost(GateCircuit& circ, PartialM
 	// note we assume all non specified elements of the constraint are set to 0
     // This part of the code implements E_{1, part} from the paper, but rewritten to increase performance.
     double normalization_cst = 0.0;
-	// note we assume all non specified elements of the constraint are set to 0
-	Eigen::MatrixXcd matr_circ = circ.toMatrix();
     double circ_size = 0.0;
     std::complex<double> conj = 0.0;
-	int size = pow(2, circ.nb_qbs);
-	for (int i = 0; i < size; i++) {
-		for (int j = 0; j < size; j++) {
-			if (constraint.cover(i, j)) {
-				normalization_cst += 1;
-                circ_size += pow(std::abs(matr_circ(i, j)), 2);
-                conj += std::conj(constraint.matrix(i, j)) * matr_circ(i, j);
-            }
-		}
-	}
-	double distance = 1 / std::sqrt(2) * std::sqrt(std::max(0.0, constraint.squared_norm + circ_size - 2 * std::abs(conj))) / std::sqrt(std::sqrt(normalization_cst));
+    coverSums(circ, constraint, normalization_cst, circ_size, conj);
+    return costFromSums(constraint.squared_norm, normalization_cst, circ_size, conj);
+}
+
+/**
+ * Calculates the exact equality cost from the sums over the cover of the constraint. Returns 0 if equal up to the tolerance, 1 otherwise.
+ *
+ * @param squared_norm The squared norm of the constraint.
+ * @param normalization_cst The number of covered entries.
+ * @param circ_size The squared norm of the covered entries of the circuit matrix.
+ * @param conj The sum of conj(constraint) * circuit over the covered entries.
+ * @return The equality cost.
+ */
+double ExactEqualityComputer::costFromSums(double squared_norm, double normalization_cst, double circ_size, std::complex<double> conj) {
+	double distance = 1 / std::sqrt(2) * std::sqrt(std::max(0.0, squared_norm + circ_size - 2 * std::abs(conj))) / std::sqrt(std::sqrt(normalization_cst));
 
     if (distance <= tolerance) {
         return 0;
@@ -86,11 +185,7 @@ double ExactEqualityComputer::normalizedEqualityCost(GateCircuit& circ, PartialM
  * @return The normalized equality cost.
  */
 double ExactEqualityComputer::normalizedEqualityCost(GateCircuit& circ, QubitIndependentPartialMatrix& matrix_obj, CircuitHelper& ch) {
-    double cur_norm = INFINITY;
-    for (std::shared_ptr<PartialMatrix> matrix : matrix_obj.matrices) {
-        cur_norm = std::min(cur_norm, normalizedEqualityCost(circ, *matrix, ch));
-    }
-    return cur_norm;
+    return EqualityComputer::normalizedEqualityCost(circ, matrix_obj, ch);
 }
 
 /**
@@ -119,21 +214,24 @@ std::shared_ptr<EqualityComputer> FroebeniusCostComputer::clone() {
  */
 double FroebeniusCostComputer::normalizedEqualityCost(GateCircuit& circ, PartialMatrix& constraint, CircuitHelper& ch){
     double normalization_cst = 0.0;
-	Eigen::MatrixXcd matr_circ = circ.toMatrix();
     double circ_size = 0.0;
     std::complex<double> conj = 0.0;
-	int size = pow(2, circ.nb_qbs);
-	for (int i = 0; i < size; i++) {
-		for (int j = 0; j < size; j++) {
-			if (constraint.cover(i, j)) {
-				normalization_cst += 1;
-                circ_size += pow(std::abs(matr_circ(i, j)), 2);
-                conj += std::conj(constraint.matrix(i, j)) * matr_circ(i, j);
-            }
-		}
-	}
+    coverSums(circ, constraint, normalization_cst, circ_size, conj);
+    return costFromSums(constraint.squared_norm, normalization_cst, circ_size, conj);
+}
+
+/**
+ * Calculates E_{1, part} from the sums over the cover of the constraint.
+ *
+ * @param squared_norm The squared norm of the constraint.
+ * @param normalization_cst The number of covered entries.
+ * @param circ_size The squared norm of the covered entries of the circuit matrix.
+ * @param conj The sum of conj(constraint) * circuit over the covered entries.
+ * @return The normalized equality cost.
+ */
+double FroebeniusCostComputer::costFromSums(double squared_norm, double normalization_cst, double circ_size, std::complex<double> conj) {
     // max is for rounding errors
-    double cost = std::sqrt(std::max(0.0, constraint.squared_norm + circ_size - 2 * std::abs(conj))) / std::sqrt(std::sqrt(normalization_cst));
+    double cost = std::sqrt(std::max(0.0, squared_norm + circ_size - 2 * std::abs(conj))) / std::sqrt(std::sqrt(normalization_cst));
 	return cost;
 }
 
@@ -162,19 +260,22 @@ std::shared_ptr<EqualityComputer> SimpleFroebeniusCostComputer::clone() {
  */
 double SimpleFroebeniusCostComputer::normalizedEqualityCost(GateCircuit& circ, PartialMatrix& constraint, CircuitHelper& ch){
     double normalization_cst = 0.0;
-	Eigen::MatrixXcd matr_circ = circ.toMatrix();
     double circ_size = 0.0;
     std::complex<double> conj = 0.0;
-	int size = pow(2, circ.nb_qbs);
-	for (int i = 0; i < size; i++) {
-		for (int j = 0; j < size; j++) {
-			if (constraint.cover(i, j)) {
-				normalization_cst += 1;
-                circ_size += pow(std::abs(matr_circ(i, j)), 2);
-                conj += std::conj(constraint.matrix(i, j)) * matr_circ(i, j);
-            }
-		}
-	}
+    coverSums(circ, constraint, normalization_cst, circ_size, conj);
+    return costFromSums(constraint.squared_norm, normalization_cst, circ_size, conj);
+}
+
+/**
+ * Calculates the equality cost, if not rewritten as done in the paper, from the sums over the cover of the constraint.
+ *
+ * @param squared_norm The squared norm of the constraint.
+ * @param normalization_cst The number of covered entries.
+ * @param circ_size The squared norm of the covered entries of the circuit matrix.
+ * @param conj The sum of conj(constraint) * circuit over the covered entries.
+ * @return The normalized equality cost.
+ */
+double SimpleFroebeniusCostComputer::costFromSums(double squared_norm, double normalization_cst, double circ_size, std::complex<double> conj) {
 	return std::sqrt(std::max(0.0, 1 - std::abs(conj) / std::sqrt(normalization_cst))) * std::sqrt(2);
 }
 
@@ -11,8 +11,15 @@ typedef Eigen::Array<bool, Eigen::Dynamic, 1> BoolArray;
 class EqualityComputer {
    public:
         double normalizedEqualityCost(GateCircuit& circ, QubitIndependentPartialMatrix& matrix_obj, CircuitHelper& ch);
+        double normalizedEqualityCost(GateCircuit& circ, QubitIndependentPartialMatrix& matrix_obj, const std::vector<int>& targets);
+        void normalizedEqualityCosts(GateCircuit& circ, QubitIndependentPartialMatrix& matrix_obj, std::vector<double>& costs);
         virtual double normalizedEqualityCost(GateCircuit& circ, PartialMatrix& matrix_obj, CircuitHelper& ch); 
         virtual std::shared_ptr<EqualityComputer> clone() = 0;
+        virtual double costFromSums(double squared_norm, double normalization_cst, double circ_size, std::complex<double> conj);
+    protected:
+        static void coverSums(GateCircuit& circ, PartialMatrix& constraint, double& normalization_cst, double& circ_size, std::complex<double>& conj);
+        template <int N>
+        static void coverSums(const std::complex<double>* matr_circ, PartialMatrix& constraint, int size, double& normalization_cst, double& circ_size, std::complex<double>& conj);
 };
 
 class ExactEqualityComputer : public EqualityComputer {
@@ -23,6 +30,7 @@ class ExactEqualityComputer : public EqualityComputer {
         ExactEqualityComputer(double tolerance): tolerance(tolerance) {};
         double normalizedEqualityCost(GateCircuit& circ, QubitIndependentPartialMatrix& matrix_obj, CircuitHelper& ch);
         double normalizedEqualityCost(GateCircuit& circ, PartialMatrix& matrix_obj, CircuitHelper& ch); 
+        double costFromSums(double squared_norm, double normalization_cst, double circ_size, std::complex<double> conj);
     private:
         double tolerance = 1e-6;
 };
@@ -33,6 +41,7 @@ class FroebeniusCostComputer: public EqualityComputer {
         FroebeniusCostComputer(FroebeniusCostComputer const& other) {};
         std::shared_ptr<EqualityComputer> clone();
         double normalizedEqualityCost(GateCircuit& circ, PartialMatrix& matrix_obj, CircuitHelper& ch); 
+        double costFromSums(double squared_norm, double normalization_cst, double circ_size, std::complex<double> conj);
 };
 
 class SimpleFroebeniusCostComputer: public EqualityComputer {
@@ -41,6 +50,7 @@ class SimpleFroebeniusCostComputer: public EqualityComputer {
         SimpleFroebeniusCostComputer(SimpleFroebeniusCostComputer const& other) {};
         std::shared_ptr<EqualityComputer> clone();
         double normalizedEqualityCost(GateCircuit& circ, PartialMatrix& matrix_obj, CircuitHelper& ch); 
+        double costFromSums(double squared_norm, double normalization_cst, double circ_size, std::complex<double> conj);
 };
 
 class PerformanceComputer{
@@ -0,0 +1,522 @@
+#include "distributed.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <cstring>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/**
+ * @brief Splits an address into its Unix socket path or its TCP host and port.
+ *
+ * @param address The address, "unix:path", "host:port" or "port".
+ * @param path Set to the path of the Unix socket, or to the empty string for a TCP address.
+ * @param host Set to the host of a TCP address, empty if the address is only a port.
+ * @param port Set to the port of a TCP address.
+ */
+static void splitAddress(const std::string& address, std::string& path, std::string& host, std::string& port) {
+    path = "";
+    host = "";
+    port = "";
+    if (address.rfind("unix:", 0) == 0) {
+        path = address.substr(5);
+        return;
+    }
+    size_t colon = address.rfind(':');
+    if (colon == std::string::npos) {
+        port = address;
+    } else {
+        host = address.substr(0, colon);
+        port = address.substr(colon + 1);
+    }
+}
+
+/**
+ * @brief Fills the address of a Unix socket.
+ *
+ * @param path The path of the socket.
+ * @return The address of the socket.
+ * @throws std::runtime_error If the path is too long for a socket address.
+ */
+static sockaddr_un unixAddress(const std::string& path) {
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        throw std::runtime_error("Socket path is too long: " + path);
+    }
+    std::strcpy(addr.sun_path, path.c_str());
+    return addr;
+}
+
+/**
+ * @brief Constructs a Connection over an open socket, which it then owns.
+ *
+ * @param fd The file descriptor of the socket.
+ */
+Connection::Connection(int fd) : fd(fd) {
+}
+
+/**
+ * @brief Closes the socket of the Connection.
+ */
+Connection::~Connection() {
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+/**
+ * @brief Opens a socket listening for workers on the given address. The file of a Unix socket is replaced if it exists.
+ *
+ * @param address The address to listen on, "unix:path", "host:port", or "port" to listen on the loopback interface only. Workers
+ * on other hosts need an explicit host, e.g. "0.0.0.0:port".
+ * @return The file descriptor of the listening socket.
+ * @throws std::runtime_error If the socket cannot be opened.
+ */
+int Connection::listenOn(const std::string& address) {
+    std::string path, host, port;
+    splitAddress(address, path, host, port);
+    int listen_fd = -1;
+    if (!path.empty()) {
+        sockaddr_un addr = unixAddress(path);
+        unlink(path.c_str());
+        listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listen_fd >= 0 && bind(listen_fd, (sockaddr*) &addr, sizeof(addr)) != 0) {
+            close(listen_fd);
+            listen_fd = -1;
+        }
+    } else {
+        addrinfo hints;
+        std::memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags = AI_PASSIVE;
+        addrinfo* results = nullptr;
+        // a bare port only accepts workers of this machine, which connect to "localhost"
+        if (getaddrinfo(host.empty() ? "127.0.0.1" : host.c_str(), port.c_str(), &hints, &results) == 0) {
+            for (addrinfo* res = results; res != nullptr && listen_fd < 0; res = res->ai_next) {
+                listen_fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+                int reuse = 1;
+                if (listen_fd >= 0 && (setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) != 0 ||
+                                       bind(listen_fd, res->ai_addr, res->ai_addrlen) != 0)) {
+                    close(listen_fd);
+                    listen_fd = -1;
+                }
+            }
+            freeaddrinfo(results);
+        }
+    }
+    if (listen_fd < 0 || listen(listen_fd, 64) != 0) {
+        throw std::runtime_error("Cannot listen on " + address + ": " + std::strerror(errno));
+    }
+    return listen_fd;
+}
+
+/**
+ * @brief Connects to a coordinator.
+ *
+ * @param address The address of the coordinator, "unix:path" or "host:port".
+ * @return A shared pointer to the Connection to the coordinator.
+ * @throws std::runtime_error If the coordinator cannot be reached.
+ */
+std::shared_ptr<Connection> Connection::connectTo(const std::string& address) {
+    std::string path, host, port;
+    splitAddress(address, path, host, port);
+    int connected_fd = -1;
+    if (!path.empty()) {
+        sockaddr_un addr = unixAddress(path);
+        connected_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (connected_fd >= 0 && connect(connected_fd, (sockaddr*) &addr, sizeof(addr)) != 0) {
+            close(connected_fd);
+            connected_fd = -1;
+        }
+    } else {
+        addrinfo hints;
+        std::memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* results = nullptr;
+        if (getaddrinfo(host.empty() ? "localhost" : host.c_str(), port.c_str(), &hints, &results) == 0) {
+            for (addrinfo* res = results; res != nullptr && connected_fd < 0; res = res->ai_next) {
+                connected_fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+                if (connected_fd >= 0 && connect(connected_fd, res->ai_addr, res->ai_addrlen) != 0) {
+                    close(connected_fd);
+                    connected_fd = -1;
+                }
+            }
+            freeaddrinfo(results);
+        }
+        if (connected_fd >= 0) {
+            // the messages are small and each waits for its reply
+            int no_delay = 1;
+            setsockopt(connected_fd, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+        }
+    }
+    if (connected_fd < 0) {
+        throw std::runtime_error("Cannot connect to " + address + ": " + std::strerror(errno));
+    }
+    return std::make_shared<Connection>(connected_fd);
+}
+
+/**
+ * @brief Accepts a worker on a listening socket.
+ *
+ * @param listen_fd The file descriptor of the listening socket.
+ * @return A shared pointer to the Connection to the worker, nullptr if no worker could be accepted.
+ */
+std::shared_ptr<Connection> Connection::acceptFrom(int listen_fd) {
+    int accepted_fd = accept(listen_fd, nullptr, nullptr);
+    if (accepted_fd < 0) {
+        return nullptr;
+    }
+    int no_delay = 1;
+    setsockopt(accepted_fd, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+    return std::make_shared<Connection>(accepted_fd);
+}
+
+/**
+ * @brief Closes a listening socket, and removes its file if it is a Unix socket.
+ *
+ * @param listen_fd The file descriptor of the listening socket.
+ * @param address The address the socket listens on.
+ */
+void Connection::stopListening(int listen_fd, const std::string& address) {
+    close(listen_fd);
+    std::string path, host, port;
+    splitAddress(address, path, host, port);
+    if (!path.empty()) {
+        unlink(path.c_str());
+    }
+}
+
+/**
+ * @brief Sends data over the connection. A closed connection does not raise SIGPIPE.
+ *
+ * @param data The data to send.
+ * @return True if all the data was sent.
+ */
+bool Connection::sendAll(const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        sent += n;
+    }
+    return true;
+}
+
+/**
+ * @brief Receives the available bytes into the buffer, waiting for at least one.
+ *
+ * @return False if the connection is closed.
+ */
+bool Connection::fill() {
+    char chunk[4096];
+    ssize_t n;
+    do {
+        n = recv(fd, chunk, sizeof(chunk), 0);
+    } while (n < 0 && errno == EINTR);
+    if (n <= 0) {
+        return false;
+    }
+    buffer.append(chunk, n);
+    return true;
+}
+
+/**
+ * @brief Reads a line, waiting until it is complete.
+ *
+ * @param line Set to the line, without its end of line.
+ * @return False if the connection is closed before the end of the line.
+ */
+bool Connection::readLine(std::string& line) {
+    size_t end;
+    while ((end = buffer.find('\n')) == std::string::npos) {
+        if (!fill()) {
+            return false;
+        }
+    }
+    line = buffer.substr(0, end);
+    buffer.erase(0, end + 1);
+    return true;
+}
+
+/**
+ * @brief Reads the given number of bytes, waiting until they are all received.
+ *
+ * @param n_bytes The number of bytes to read.
+ * @param data Set to the bytes read.
+ * @return False if the connection is closed before all bytes are received.
+ */
+bool Connection::readBytes(size_t n_bytes, std::string& data) {
+    while (buffer.size() < n_bytes) {
+        if (!fill()) {
+            return false;
+        }
+    }
+    data = buffer.substr(0, n_bytes);
+    buffer.erase(0, n_bytes);
+    return true;
+}
+
+/**
+ * @brief Receives the bytes available on the socket into the buffer. Called once the socket is reported readable by poll, so that it
+ * does not wait.
+ *
+ * @return False if the connection is closed.
+ */
+bool Connection::receive() {
+    return fill();
+}
+
+/**
+ * @brief Takes the next message out of the buffer, without waiting for the rest of it: its line and, for FOUND messages, the payload
+ * whose size is the last field of the line. Only the coordinator takes messages this way, so the only messages with a payload are FOUND
+ * messages. Nothing is taken until the whole message is received, so that a slow peer does not hold up the others.
+ *
+ * @param line Set to the line of the message, without its end of line.
+ * @param payload Set to the payload of the message, empty for messages without one.
+ * @param complete Set to whether a whole message was received and taken.
+ * @return False if the message is malformed: its line is longer than max_line_bytes, or its payload size is not a number or exceeds
+ * max_payload_bytes.
+ */
+bool Connection::takeMessage(std::string& line, std::string& payload, bool& complete) {
+    complete = false;
+    size_t end = buffer.find('\n');
+    if (end == std::string::npos) {
+        return buffer.size() <= max_line_bytes;
+    }
+    if (end > max_line_bytes) {
+        return false;
+    }
+    std::string header = buffer.substr(0, end);
+    std::istringstream fields(header);
+    std::string keyword;
+    fields >> keyword;
+    size_t n_bytes = 0;
+    if (keyword == "FOUND") {
+        size_t last_space = header.find_last_of(' ');
+        std::string size_field = last_space == std::string::npos ? "" : header.substr(last_space + 1);
+        if (size_field.empty() || size_field.size() > 9 || size_field.find_first_not_of("0123456789") != std::string::npos) {
+            return false;
+        }
+        n_bytes = std::stoul(size_field);
+        if (n_bytes > max_payload_bytes) {
+            return false;
+        }
+    }
+    if (buffer.size() < end + 1 + n_bytes) {
+        return true;
+    }
+    line = header;
+    payload = buffer.substr(end + 1, n_bytes);
+    buffer.erase(0, end + 1 + n_bytes);
+    complete = true;
+    return true;
+}
+
+/**
+ * @brief Returns the file descriptor of the socket, to poll it.
+ *
+ * @return The file descriptor.
+ */
+int Connection::getFd() {
+    return fd;
+}
+
+/**
+ * @brief Serializes the found circuit as a FOUND message.
+ *
+ * @return The message.
+ */
+std::string FoundCircuit::serialize() {
+    std::ostringstream oss;
+    oss.precision(17);
+    oss << "FOUND " << epoch << " " << optimal << " " << save << " " << scheme_gates << " " << gates_before << " " << gates_after << " "
+        << tcount_before << " " << tcount_after << " " << tdepth_before << " " << tdepth_after << " " << cost << " " << count << " "
+        << depth << " " << qasm.size() << "\n" << qasm;
+    return oss.str();
+}
+
+/**
+ * @brief Parses the fields of a FOUND message, after its keyword, and takes its circuit.
+ *
+ * @param fields The fields of the message line.
+ * @param payload The payload of the message, see Connection::takeMessage.
+ * @return False if the message is malformed.
+ */
+bool FoundCircuit::parse(std::istringstream& fields, const std::string& payload) {
+    size_t n_bytes;
+    fields >> epoch >> optimal >> save >> scheme_gates >> gates_before >> gates_after >> tcount_before >> tcount_after
+           >> tdepth_before >> tdepth_after >> cost >> count >> depth >> n_bytes;
+    if (fields.fail() || n_bytes != payload.size()) {
+        return false;
+    }
+    qasm = payload;
+    return true;
+}
+
+/**
+ * @brief Constructs a WorkerLink connected to a coordinator.
+ *
+ * @param address The address of the coordinator, "unix:path" or "host:port".
+ * @throws std::runtime_error If the coordinator cannot be reached.
+ */
+WorkerLink::WorkerLink(const std::string& address) {
+    connection = Connection::connectTo(address);
+}
+
+/**
+ * @brief Removes the local copy of the specification.
+ */
+WorkerLink::~WorkerLink() {
+    if (!spec_path.empty()) {
+        std::error_code ec;
+        std::filesystem::remove(spec_path, ec);
+    }
+}
+
+/**
+ * @brief Registers the worker with the coordinator and receives the specification and the arguments of the coordinator. The specification is
+ * written to a temporary file, so that workers on other hosts do not need a copy of the input folder.
+ *
+ * @return The arguments to parse, starting with the path of the specification, as main would receive them after its name.
+ * @throws std::runtime_error If the coordinator does not accept the worker.
+ */
+std::vector<std::string> WorkerLink::handshake() {
+    std::string line;
+    if (!connection->sendAll("HELLO\n") || !connection->readLine(line)) {
+        throw std::runtime_error("The coordinator closed the connection.");
+    }
+    std::istringstream fields(line);
+    std::string keyword;
+    double remaining;
+    int n_args;
+    size_t spec_bytes;
+    fields >> keyword >> worker_index >> remaining >> n_args >> spec_bytes;
+    // the arguments start with the name of the specification
+    if (fields.fail() || keyword != "SPEC" || n_args < 1 || n_args > max_line_bytes || spec_bytes > max_payload_bytes) {
+        throw std::runtime_error("The coordinator did not accept the worker: " + line);
+    }
+    std::vector<std::string> args(n_args);
+    for (int i = 0; i < n_args; i++) {
+        if (!connection->readLine(args[i])) {
+            throw std::runtime_error("The coordinator closed the connection.");
+        }
+    }
+    std::string spec;
+    if (!connection->readBytes(spec_bytes, spec)) {
+        throw std::runtime_error("The coordinator closed the connection.");
+    }
+    // the first argument is the name of the specification, whose extension gives its format
+    std::string name = std::filesystem::path(args[0]).filename().string();
+    spec_path = (std::filesystem::temp_directory_path() / ("synthetiq_" + std::to_string(getpid()) + "_" + name)).string();
+    std::ofstream file(spec_path, std::ios::binary);
+    file << spec;
+    file.close();
+    args[0] = spec_path;
+    args.push_back("--absolute-input");
+    args.push_back("--time");
+    args.push_back(std::to_string(remaining));
+    return args;
+}
+
+/**
+ * @brief Sets the number of start gates pulled from the coordinator at once.
+ *
+ * @param size The size of the batches, usually the number of threads of the worker, at most max_batch_runs.
+ */
+void WorkerLink::setBatchSize(int size) {
+    batch_size = std::min(std::max(1, size), max_batch_runs);
+}
+
+/**
+ * @brief Returns the number of gates of the next restart, pulling a new batch from the coordinator if the previous one is used up.
+ *
+ * @param epoch Set to the epoch of the batch the restart belongs to.
+ * @return The number of gates, -1 once the coordinator has stopped the search.
+ */
+int WorkerLink::nextStartGates(int& epoch) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (batch.empty() && !stopped) {
+        std::string line;
+        if (!connection->sendAll("BATCH " + std::to_string(batch_size) + "\n") || !connection->readLine(line)) {
+            stopped = true;
+        } else {
+            std::istringstream fields(line);
+            std::string keyword;
+            fields >> keyword >> batch_epoch;
+            int start_gates;
+            while (keyword == "RUNS" && fields >> start_gates) {
+                batch.push_back(start_gates);
+            }
+            stopped = batch.empty();
+        }
+    }
+    if (stopped) {
+        return -1;
+    }
+    epoch = batch_epoch;
+    int start_gates = batch.front();
+    batch.pop_front();
+    return start_gates;
+}
+
+/**
+ * @brief Sends a found circuit to the coordinator. The rest of the batch is dropped if the coordinator has started a new epoch since.
+ *
+ * @param found The found circuit.
+ * @return False once the coordinator has stopped the search.
+ */
+bool WorkerLink::report(FoundCircuit& found) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::string line;
+    if (stopped || !connection->sendAll(found.serialize()) || !connection->readLine(line)) {
+        stopped = true;
+        return false;
+    }
+    std::istringstream fields(line);
+    std::string keyword;
+    int epoch;
+    fields >> keyword >> epoch;
+    if (keyword != "OK") {
+        stopped = true;
+        return false;
+    }
+    if (epoch != batch_epoch) {
+        batch.clear();
+    }
+    return true;
+}
+
+/**
+ * @brief Checks whether the coordinator has stopped the search, or closed the connection.
+ *
+ * @return True if the search is stopped.
+ */
+bool WorkerLink::isStopped() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stopped;
+}
+
+/**
+ * @brief Returns the index the coordinator gave to the worker, which distinguishes the seeds of the workers.
+ *
+ * @return The index of the worker.
+ */
+int WorkerLink::getWorkerIndex() {
+    return worker_index;
+}
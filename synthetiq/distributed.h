@@ -0,0 +1,96 @@
+#ifndef DEF_DISTRIBUTED
+#define DEF_DISTRIBUTED
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Messages between the coordinator and its workers are a line of space-separated fields, followed, for the messages with a payload,
+// by as many bytes as given by their last field. Every message of a worker gets exactly one reply from the coordinator:
+//   HELLO                          -> SPEC <worker index> <remaining seconds> <nb args> <spec bytes>, one arg per line, then the spec
+//   BATCH <nb runs>                -> RUNS <epoch> <start gates>... | STOP
+//   FOUND <fields> <qasm bytes>    -> OK <epoch> | STOP
+// The epoch counts the circuits found with the required cost, after which the coordinator resets its gate scheme, as a single
+// process does between two runs of its inner loop.
+
+const size_t max_line_bytes = 1 << 16; // longest message line, a longer one is malformed
+const size_t max_payload_bytes = 1 << 24; // largest payload of a message, a specification or a circuit
+const int max_batch_runs = 1024; // most restarts handed out for one BATCH message
+
+class Connection {
+    // a stream socket to a coordinator or a worker, over TCP for addresses "host:port" or over a Unix socket for "unix:path"
+    public:
+        Connection(int fd);
+        ~Connection();
+        Connection(const Connection&) = delete;
+        Connection& operator=(const Connection&) = delete;
+
+        static int listenOn(const std::string& address);
+        static std::shared_ptr<Connection> connectTo(const std::string& address);
+        static std::shared_ptr<Connection> acceptFrom(int listen_fd);
+        static void stopListening(int listen_fd, const std::string& address);
+        bool sendAll(const std::string& data);
+        bool readLine(std::string& line);
+        bool readBytes(size_t n_bytes, std::string& data);
+        bool receive();
+        bool takeMessage(std::string& line, std::string& payload, bool& complete);
+        int getFd();
+
+    private:
+        bool fill();
+
+        int fd;
+        std::string buffer; // bytes received but not read yet
+};
+
+class FoundCircuit {
+    // a circuit found by a worker, after its resynthesis, with the statistics the coordinator needs to report and save it
+    public:
+        int epoch = 0;
+        bool optimal = false; // the circuit has the required cost, so the coordinator starts a new epoch
+        bool save = false; // the circuit satisfies the cost constraints and counts as found
+        int scheme_gates = 0; // number of gates the gate scheme is updated with
+        int gates_before = 0;
+        int gates_after = 0;
+        int tcount_before = 0;
+        int tcount_after = 0;
+        int tdepth_before = 0;
+        int tdepth_after = 0;
+        double cost = 0;
+        int count = 0; // count and depth of the depth gates, for the file name
+        int depth = 0;
+        std::string qasm;
+
+        std::string serialize();
+        bool parse(std::istringstream& fields, const std::string& payload);
+};
+
+class WorkerLink {
+    // the connection of a worker process to its coordinator, shared by the threads of the worker. The start gates of the restarts
+    // are pulled from the coordinator in batches of one per thread, and the found circuits are sent back to it.
+    public:
+        WorkerLink(const std::string& address);
+        ~WorkerLink();
+
+        std::vector<std::string> handshake();
+        void setBatchSize(int size);
+        int nextStartGates(int& epoch);
+        bool report(FoundCircuit& found);
+        bool isStopped();
+        int getWorkerIndex();
+
+    private:
+        std::shared_ptr<Connection> connection;
+        std::mutex mutex;
+        std::deque<int> batch;
+        int batch_epoch = 0;
+        int batch_size = 1;
+        bool stopped = false;
+        int worker_index = 0;
+        std::string spec_path; // local copy of the specification sent by the coordinator
+};
+
+#endif
@@ -0,0 +1,91 @@
+#include "elite_pool.h"
+#include <algorithm>
+
+/**
+ * @brief Constructs an empty ElitePool.
+ *
+ * @param capacity The maximum number of circuits kept, the worst one is dropped when a better one is added to a full pool.
+ */
+ElitePool::ElitePool(int capacity) : capacity(std::max(1, capacity)) {
+}
+
+/**
+ * @brief Compares two elites. Equality costs below the tolerance of found circuits are considered equal, so that found circuits are ranked by cost.
+ *
+ * @param a The first elite.
+ * @param b The second elite.
+ * @return True if a ranks before b.
+ */
+bool ElitePool::better(const Elite& a, const Elite& b) {
+    double eq_a = a.eq < 1e-3 ? 0.0 : a.eq;
+    double eq_b = b.eq < 1e-3 ? 0.0 : b.eq;
+    if (eq_a != eq_b) {
+        return eq_a < eq_b;
+    }
+    return a.cost < b.cost;
+}
+
+/**
+ * @brief Adds a circuit to the pool, unless the pool is full of better circuits or already contains the same gates.
+ *
+ * @param circuit The circuit to add.
+ * @param eq The equality cost of the circuit.
+ * @return True if the circuit was added.
+ */
+bool ElitePool::add(GateCircuit& circuit, double eq) {
+    Elite elite;
+    elite.eq = eq;
+    elite.cost = circuit.getCost();
+    const std::vector<GateId>& gates = circuit.getGateIds();
+    for (int g = 0; g < gates.size(); g++) {
+        if (!circuit.isIdentityAt(g)) {
+            elite.gates.push_back(gates[g]);
+        }
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    if (elites.size() >= capacity && !better(elite, elites.back())) {
+        return false;
+    }
+    for (Elite& other : elites) {
+        if (other.gates == elite.gates) {
+            return false;
+        }
+    }
+    int position = elites.size();
+    while (position > 0 && better(elite, elites[position - 1])) {
+        position--;
+    }
+    elites.insert(elites.begin() + position, elite);
+    if (elites.size() > capacity) {
+        elites.pop_back();
+    }
+    return true;
+}
+
+/**
+ * @brief Draws an elite, the better of two drawn uniformly, so that the best circuits are drawn more often without the pool collapsing to one.
+ *
+ * @param random_helper The RandomHelper object used for the draw.
+ * @param gates Set to the non-identity gates of the drawn elite.
+ * @return False if the pool is empty.
+ */
+bool ElitePool::sample(RandomHelper& random_helper, std::vector<GateId>& gates) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (elites.empty()) {
+        return false;
+    }
+    int first = random_helper.randomInt(elites.size());
+    int second = random_helper.randomInt(elites.size());
+    gates = elites[std::min(first, second)].gates;
+    return true;
+}
+
+/**
+ * @brief Returns the number of circuits in the pool.
+ *
+ * @return The number of circuits.
+ */
+int ElitePool::size() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return elites.size();
+}
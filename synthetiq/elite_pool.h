@@ -0,0 +1,33 @@
+#ifndef DEF_ELITE_POOL
+#define DEF_ELITE_POOL
+
+#include "circuit.h"
+#include "randomhelper.h"
+#include <mutex>
+#include <vector>
+
+class ElitePool {
+    // the best circuits of the runs so far, shared by all threads: the found circuits after their resynthesis, and the best circuits of the
+    // runs that found none. They are ranked by equality cost, the found circuits first, and then by cost. Restarts can start from a perturbed
+    // elite instead of a random circuit.
+    public:
+        ElitePool(int capacity=16);
+        bool add(GateCircuit& circuit, double eq);
+        bool sample(RandomHelper& random_helper, std::vector<GateId>& gates);
+        int size();
+
+    private:
+        struct Elite {
+            std::vector<GateId> gates; // non-identity gates of the circuit, in order
+            double eq;
+            double cost;
+        };
+
+        bool better(const Elite& a, const Elite& b);
+
+        int capacity;
+        std::vector<Elite> elites; // sorted from the best
+        std::mutex mutex;
+};
+
+#endif
@@ -0,0 +1,259 @@
+#include "environment_cost.h"
+#include <cmath>
+
+/**
+ * Constructor for the EnvironmentCostOracle class. For a circuit U = R * G * L where G is the gate at the current position,
+ * the inner product between a target M and U on the cover is tr(E * G) with the environment E = L * M^dagger * R, where M is set to zero
+ * outside its cover. The oracle keeps E for every target, so that the equality cost of any candidate gate at the position is a contraction
+ * of its local 2^k x 2^k matrix with the partial trace of E on the qubits of the gate. This is only exact if the squared norm of the circuit
+ * on the cover does not depend on the circuit, which holds if the cover consists of full columns or full rows.
+ */
+EnvironmentCostOracle::EnvironmentCostOracle() {
+
+}
+
+/**
+ * @brief Constructs an EnvironmentCostOracle for the targets of the given matrix object.
+ *
+ * @param matrix_obj The qubit independent partial matrix to synthesize.
+ * @param enable_permutations Whether all permuted targets are used or only the original one, as in MCMC::equalityCost.
+ */
+EnvironmentCostOracle::EnvironmentCostOracle(QubitIndependentPartialMatrix& matrix_obj, bool enable_permutations) {
+    nb_qbs = matrix_obj.getNQubits();
+    supported = true;
+    if (enable_permutations) {
+        for (const std::shared_ptr<PartialMatrix>& matrix : matrix_obj.matrices) {
+            addTarget(*matrix);
+        }
+    } else {
+        addTarget(matrix_obj.original);
+    }
+    int size = 1 << nb_qbs;
+    reduced = std::vector<std::vector<Eigen::MatrixXcd>>(size);
+    reduced_stamp = std::vector<int>(size, -1);
+}
+
+/**
+ * @brief Adds a target to the oracle.
+ *
+ * @param constraint The partial matrix of the target.
+ */
+void EnvironmentCostOracle::addTarget(PartialMatrix& constraint) {
+    supported = supported && supports(constraint);
+    double normalization_cst = constraint.cover.count();
+    // the columns, or rows, of a unitary have norm 1
+    circ_size = normalization_cst / (1 << nb_qbs);
+    Eigen::MatrixXcd masked = constraint.cover.select(constraint.matrix, Eigen::MatrixXcd::Zero(constraint.matrix.rows(), constraint.matrix.cols()));
+    adjoint_targets.push_back(masked.adjoint());
+    squared_norms.push_back(constraint.squared_norm);
+    normalization_csts.push_back(normalization_cst);
+    environments.push_back(Eigen::MatrixXcd());
+}
+
+/**
+ * @brief Checks whether the cover of the constraint consists of full columns or of full rows.
+ *
+ * @param constraint The partial matrix constraint.
+ * @return True if the oracle computes exact costs for the constraint.
+ */
+bool EnvironmentCostOracle::supports(PartialMatrix& constraint) {
+    const BoolMatrix& cover = constraint.cover;
+    bool full_columns = true;
+    for (int j = 0; j < cover.cols() && full_columns; j++) {
+        full_columns = cover.col(j).all() || !cover.col(j).any();
+    }
+    bool full_rows = true;
+    for (int i = 0; i < cover.rows() && full_rows; i++) {
+        full_rows = cover.row(i).all() || !cover.row(i).any();
+    }
+    return (full_columns || full_rows) && cover.any();
+}
+
+/**
+ * @brief Checks whether all targets of the oracle are supported.
+ *
+ * @return True if the oracle can be used instead of the equality computer.
+ */
+bool EnvironmentCostOracle::isSupported() {
+    return supported;
+}
+
+/**
+ * @brief Returns the position whose environment is currently stored.
+ *
+ * @return The position, -1 if the oracle was not initialized on a circuit.
+ */
+int EnvironmentCostOracle::getPosition() {
+    return position;
+}
+
+/**
+ * Recomputes the environments of the given position from the gates of the circuit.
+ *
+ * @param circ The gate circuit.
+ * @param new_position The position of the mutations.
+ */
+void EnvironmentCostOracle::reset(GateCircuit& circ, int new_position) {
+    int size = 1 << nb_qbs;
+    prefix.setIdentity(size, size);
+    suffix.setIdentity(size, size);
+    for (int i = 0; i < new_position; i++) {
+        circ.getGate(i)->applyLeft(prefix);
+    }
+    for (int i = new_position + 1; i < circ.nbElements(); i++) {
+        circ.getGate(i)->applyLeft(suffix);
+    }
+    for (int t = 0; t < environments.size(); t++) {
+        product.noalias() = adjoint_targets[t] * suffix;
+        environments[t].noalias() = prefix * product;
+    }
+    position = new_position;
+    stamp++;
+}
+
+/**
+ * Moves the oracle to the given position. Moving to the next position only multiplies the environments with the gate at the current
+ * position on the left and with the adjoint of the gate at the next position on the right, any other move recomputes the environments.
+ *
+ * @param circ The gate circuit.
+ * @param new_position The position of the mutations.
+ */
+void EnvironmentCostOracle::moveTo(GateCircuit& circ, int new_position) {
+    if (new_position == position) {
+        return;
+    }
+    if (new_position != position + 1 || position < 0) {
+        reset(circ, new_position);
+        return;
+    }
+    const std::shared_ptr<Gate>& passed = circ.getGate(position);
+    const std::shared_ptr<Gate>& next = circ.getGate(new_position);
+    for (Eigen::MatrixXcd& environment : environments) {
+        passed->applyLeft(environment);
+        multiplyRightByAdjoint(environment, *next);
+    }
+    position = new_position;
+    stamp++;
+}
+
+/**
+ * Multiplies the target on the right with the adjoint of the gate, acting on the columns of the target with the local matrix of the gate.
+ *
+ * @param target The matrix to multiply.
+ * @param gate The gate.
+ */
+void EnvironmentCostOracle::multiplyRightByAdjoint(Eigen::MatrixXcd& target, const Gate& gate) {
+    int local_size = gate.local_matrix.rows();
+    if (local_size == 1) {
+        if (gate.local_matrix(0, 0) != std::complex<double>(1.0, 0.0)) {
+            target *= std::conj(gate.local_matrix(0, 0));
+        }
+        return;
+    }
+    int size = target.rows();
+    columns.resize(size, local_size);
+    for (int base = 0; base < size; base = ((base | gate.local_mask) + 1) & ~gate.local_mask) {
+        for (int b = 0; b < local_size; b++) {
+            columns.col(b) = target.col(base + gate.local_offsets[b]);
+        }
+        // column a of target * G^dagger is the sum over b of conj(g(a, b)) times column b of target
+        for (int a = 0; a < local_size; a++) {
+            auto column = target.col(base + gate.local_offsets[a]);
+            column.setZero();
+            for (int b = 0; b < local_size; b++) {
+                if (gate.local_matrix(a, b) != 0.0) {
+                    column += std::conj(gate.local_matrix(a, b)) * columns.col(b);
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief Returns the bits of index at the positions of mask, packed into the lowest bits.
+ *
+ * @param index The index in the register.
+ * @param mask The mask of the qubits.
+ * @return The compressed index.
+ */
+int EnvironmentCostOracle::compressIndex(int index, int mask) {
+    int result = 0;
+    int bit = 0;
+    for (int q = 0; (mask >> q) != 0; q++) {
+        if ((mask >> q) & 1) {
+            result |= ((index >> q) & 1) << bit;
+            bit++;
+        }
+    }
+    return result;
+}
+
+/**
+ * Calculates the partial trace of every environment over the qubits outside of the mask.
+ * Entry (i, j) is the sum over the indices outside of the mask of the environment at the rows and columns whose bits in the mask are i and j.
+ *
+ * @param mask The mask of the qubits that are kept.
+ */
+void EnvironmentCostOracle::calculateReduced(int mask) {
+    int size = 1 << nb_qbs;
+    int reduced_size = 1 << __builtin_popcount(mask);
+    deposited.resize(reduced_size);
+    for (int i = 0; i < reduced_size; i++) {
+        int index = 0;
+        int bit = 0;
+        for (int q = 0; q < nb_qbs; q++) {
+            if ((mask >> q) & 1) {
+                index |= ((i >> bit) & 1) << q;
+                bit++;
+            }
+        }
+        deposited[i] = index;
+    }
+    std::vector<Eigen::MatrixXcd>& reduced_mask = reduced[mask];
+    reduced_mask.resize(environments.size());
+    for (int t = 0; t < environments.size(); t++) {
+        Eigen::MatrixXcd& result = reduced_mask[t];
+        result.setZero(reduced_size, reduced_size);
+        const Eigen::MatrixXcd& environment = environments[t];
+        for (int base = 0; base < size; base = ((base | mask) + 1) & ~mask) {
+            for (int j = 0; j < reduced_size; j++) {
+                for (int i = 0; i < reduced_size; i++) {
+                    result(i, j) += environment(base + deposited[i], base + deposited[j]);
+                }
+            }
+        }
+    }
+    reduced_stamp[mask] = stamp;
+}
+
+/**
+ * Calculates the equality cost of the circuit if the gate is placed at the current position, as the minimum over the targets.
+ *
+ * @param gate The candidate gate.
+ * @param equality_computer The equality computer providing the cost formula, see EqualityComputer::costFromSums.
+ * @return The equality cost.
+ */
+double EnvironmentCostOracle::cost(const std::shared_ptr<Gate>& gate, EqualityComputer& equality_computer) {
+    int mask = gate->local_mask;
+    if (reduced_stamp[mask] != stamp) {
+        calculateReduced(mask);
+    }
+    int local_size = gate->local_matrix.rows();
+    local_compressed.resize(local_size);
+    for (int l = 0; l < local_size; l++) {
+        local_compressed[l] = compressIndex(gate->local_offsets[l], mask);
+    }
+    double best_cost = INFINITY;
+    for (int t = 0; t < environments.size(); t++) {
+        const Eigen::MatrixXcd& reduced_target = reduced[mask][t];
+        // tr(E * G) = sum over a, b of g(a, b) * E(b, a) restricted to the qubits of the gate
+        std::complex<double> conj = 0.0;
+        for (int b = 0; b < local_size; b++) {
+            for (int a = 0; a < local_size; a++) {
+                conj += gate->local_matrix(a, b) * reduced_target(local_compressed[b], local_compressed[a]);
+            }
+        }
+        best_cost = std::min(best_cost, equality_computer.costFromSums(squared_norms[t], normalization_csts[t], circ_size, conj));
+    }
+    return best_cost;
+}
@@ -0,0 +1,49 @@
+#ifndef DEF_ENVIRONMENT_COST
+#define DEF_ENVIRONMENT_COST
+#include <vector>
+#include <memory>
+#include <Eigen/Dense>
+#include "gate.h"
+#include "circuit.h"
+#include "cost.h"
+#include "partialMatrix.h"
+
+class EnvironmentCostOracle {
+    // usage: call moveTo with the position of the mutation, then cost for any candidate gate at that position.
+    // Between two calls of moveTo, only the gate at the current position may change in the circuit.
+    public:
+        EnvironmentCostOracle();
+        EnvironmentCostOracle(QubitIndependentPartialMatrix& matrix_obj, bool enable_permutations=true);
+        static bool supports(PartialMatrix& constraint);
+        bool isSupported();
+        int getPosition();
+        void reset(GateCircuit& circ, int position);
+        void moveTo(GateCircuit& circ, int position);
+        double cost(const std::shared_ptr<Gate>& gate, EqualityComputer& equality_computer);
+
+    private:
+        void addTarget(PartialMatrix& constraint);
+        void calculateReduced(int mask);
+        void multiplyRightByAdjoint(Eigen::MatrixXcd& target, const Gate& gate);
+        static int compressIndex(int index, int mask);
+
+        int nb_qbs = 0;
+        int position = -1;
+        int stamp = 0;
+        bool supported = false;
+        double circ_size = 0.0;
+        std::vector<Eigen::MatrixXcd> adjoint_targets; // adjoint of each target, zero outside its cover
+        std::vector<double> squared_norms;
+        std::vector<double> normalization_csts;
+        std::vector<Eigen::MatrixXcd> environments; // L * adjoint_target * R for the gates L before and R after the position
+        std::vector<std::vector<Eigen::MatrixXcd>> reduced; // reduced[mask][t] is the partial trace of environments[t] on the qubits of mask
+        std::vector<int> reduced_stamp;
+        std::vector<int> deposited;
+        std::vector<int> local_compressed;
+        Eigen::MatrixXcd prefix;
+        Eigen::MatrixXcd suffix;
+        Eigen::MatrixXcd product;
+        Eigen::MatrixXcd columns;
+};
+
+#endif
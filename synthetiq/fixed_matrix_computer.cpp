@@ -0,0 +1,217 @@
+#include "fixed_matrix_computer.h"
+#include <cmath>
+
+/**
+ * Constructor for the BinaryMatrixComputerT class. This class computes the matrix of the circuit by using a binary tree, like the BinaryMatrixComputer,
+ * but the number of qubits is known at compile time so that Eigen can unroll and vectorize the products of the nodes.
+ */
+template <int N>
+BinaryMatrixComputerT<N>::BinaryMatrixComputerT() {
+
+}
+
+/**
+ * @brief Constructs a BinaryMatrixComputerT object.
+ *
+ * @param n_gates The number of gates.
+ * @param ch The CircuitHelper whose gate table the gate ids refer to.
+ */
+template <int N>
+BinaryMatrixComputerT<N>::BinaryMatrixComputerT(int n_gates, std::shared_ptr<CircuitHelper> ch) {
+    this->ch = ch;
+    initializeTree(n_gates);
+}
+
+template <int N>
+const int BinaryMatrixComputerT<N>::stride = ((1 << (2 * N)) * sizeof(std::complex<double>) + arena_alignment - 1) / arena_alignment * arena_alignment
+                                             / sizeof(std::complex<double>);
+
+/**
+ * Initializes the tree data structure for the BinaryMatrixComputerT. As for the BinaryMatrixComputer, the nodes are stored in a single arena,
+ * the leaves first and the root last, and every level has one spare slot, see updateMatrix. The arena and the slot lists keep their memory
+ * when the number of gates changes, so that restarts with a new number of gates do not reallocate the tree.
+ *
+ * @param n_gates The number of gates in the circuit.
+ */
+template <int N>
+void BinaryMatrixComputerT<N>::initializeTree(int n_gates) {
+    nb_gates = n_gates;
+    int depth = std::max((int) std::ceil(std::log2(n_gates)), 1);
+    slots.resize(depth);
+    spares.resize(depth);
+    int n_slots = 0;
+    for (int i = 0; i < depth; i++) {
+        int size = (n_gates + (2 << i) - 1) >> (i + 1);
+        slots[i].clear();
+        for (int j = 0; j < size; j++) {
+            slots[i].push_back(n_slots++);
+        }
+        spares[i] = n_slots++;
+    }
+    arena.resize((size_t) n_slots * stride);
+    for (int i = 0; i < depth; i++) {
+        for (int j = 0; j < slots[i].size(); j++) {
+            node(i, j).setIdentity();
+        }
+    }
+    last_leaf = -1;
+}
+
+/**
+ * @brief Returns the node at the given depth and position as a matrix backed by the arena.
+ *
+ * @param depth The depth of the node, 0 for the leaves.
+ * @param position The position of the node in its level.
+ * @return The node.
+ */
+template <int N>
+typename BinaryMatrixComputerT<N>::Node BinaryMatrixComputerT<N>::node(int depth, int position) {
+    return Node(arena.data() + (size_t) slots[depth][position] * stride);
+}
+
+/**
+ * Calculates the leaf of the tree containing the gates at positions i and i + 1, where i is even.
+ *
+ * @param i The position of the first gate of the leaf.
+ * @param list_gates The list of gates.
+ */
+template <int N>
+void BinaryMatrixComputerT<N>::calculateLeaf(int i, const std::vector<GateId>& list_gates) {
+    Node leaf = node(0, slots[0].size() - 1 - i / 2);
+    leaf.setIdentity();
+    //note: the gates need to be turned around because the last gate is applied
+    ch->readable_gates[list_gates[i]]->applyLeft(leaf.data(), 1 << N, 1 << N);
+    if (i + 1 < list_gates.size()) {
+        ch->readable_gates[list_gates[i + 1]]->applyLeft(leaf.data(), 1 << N, 1 << N);
+    }
+}
+
+/**
+ * Calculates the node at the given depth and position from its two children.
+ *
+ * @param depth The depth of the node, at least 1.
+ * @param position The position of the node in its level.
+ */
+template <int N>
+void BinaryMatrixComputerT<N>::calculateNode(int depth, int position) {
+    int earlier_position = 2 * position;
+    if (earlier_position == slots[depth - 1].size() - 1) {
+        node(depth, position) = node(depth - 1, earlier_position);
+    } else {
+        node(depth, position).noalias() = node(depth - 1, earlier_position) * node(depth - 1, earlier_position + 1);
+    }
+}
+
+/**
+ * Updates the leaf containing the given position and all its ancestors. Each updated node is first exchanged with the spare matrix of its level
+ * and then recalculated, so that the spare matrices keep the previous path for rollback.
+ *
+ * @param i The index at which the circuit was changed
+ * @param list_gates The list of gates.
+ */
+template <int N>
+void BinaryMatrixComputerT<N>::updateMatrix(int i, const std::vector<GateId>& list_gates) {
+    int starting_pos = slots[0].size() - 1 - i / 2;
+    std::swap(slots[0][starting_pos], spares[0]);
+    calculateLeaf(i - i % 2, list_gates);
+    for (int current_depth = 1; current_depth < slots.size(); current_depth++) {
+        std::swap(slots[current_depth][starting_pos >> current_depth], spares[current_depth]);
+        calculateNode(current_depth, starting_pos >> current_depth);
+    }
+    last_leaf = starting_pos;
+}
+
+/**
+ * Restores the path of the last update by exchanging its nodes with the spare matrices again.
+ *
+ * @return True if the matrix was restored, false if there was no update since the tree was calculated or rolled back.
+ */
+template <int N>
+bool BinaryMatrixComputerT<N>::rollback() {
+    if (last_leaf < 0) {
+        return false;
+    }
+    for (int current_depth = 0; current_depth < slots.size(); current_depth++) {
+        std::swap(slots[current_depth][last_leaf >> current_depth], spares[current_depth]);
+    }
+    last_leaf = -1;
+    return true;
+}
+
+/**
+ * Calculates the matrix representation of a quantum circuit given a list of gates.
+ * If the size of the list of gates is different from the expected number of gates, the tree is initialized.
+ *
+ * @param list_gates The list of gates to be applied in the circuit.
+ */
+template <int N>
+void BinaryMatrixComputerT<N>::calculateMatrix(const std::vector<GateId>& list_gates) {
+    if (list_gates.size() != nb_gates) {
+        initializeTree(list_gates.size());
+    }
+
+    for (int i = 0; i < list_gates.size(); i += 2) {
+        calculateLeaf(i, list_gates);
+    }
+
+    for (int current_depth = 1; current_depth < slots.size(); current_depth++) {
+        for (int position = 0; position < slots[current_depth].size(); position++) {
+            calculateNode(current_depth, position);
+        }
+    }
+    last_leaf = -1;
+}
+
+/**
+ * @brief Returns the matrix representation of the BinaryMatrixComputerT.
+ *
+ * @return The matrix representation of the BinaryMatrixComputerT.
+ */
+template <int N>
+Eigen::MatrixXcd BinaryMatrixComputerT<N>::getMatrix() {
+    return node(slots.size() - 1, 0);
+}
+
+/**
+ * @brief Returns the entries of the matrix of the circuit in column-major order, without copying them.
+ *
+ * @return A pointer to the entries of the matrix, valid until the circuit changes.
+ */
+template <int N>
+const std::complex<double>* BinaryMatrixComputerT<N>::getMatrixData() {
+    return node(slots.size() - 1, 0).data();
+}
+
+template class BinaryMatrixComputerT<1>;
+template class BinaryMatrixComputerT<2>;
+template class BinaryMatrixComputerT<3>;
+template class BinaryMatrixComputerT<4>;
+template class BinaryMatrixComputerT<5>;
+template class BinaryMatrixComputerT<6>;
+
+/**
+ * @brief Creates the fixed-size binary matrix computer for the given number of qubits.
+ *
+ * @param nb_gates The number of gates.
+ * @param nb_qbs The number of qubits, at most max_fixed_qubits. For larger circuits, a BinaryMatrixComputer is returned.
+ * @param ch The CircuitHelper whose gate table the gate ids refer to.
+ * @return A shared pointer to the matrix computer.
+ */
+std::shared_ptr<MatrixComputer> createFixedBinaryMatrixComputer(int nb_gates, int nb_qbs, std::shared_ptr<CircuitHelper> ch) {
+    switch (nb_qbs) {
+        case 1:
+            return std::make_shared<BinaryMatrixComputerT<1>>(nb_gates, ch);
+        case 2:
+            return std::make_shared<BinaryMatrixComputerT<2>>(nb_gates, ch);
+        case 3:
+            return std::make_shared<BinaryMatrixComputerT<3>>(nb_gates, ch);
+        case 4:
+            return std::make_shared<BinaryMatrixComputerT<4>>(nb_gates, ch);
+        case 5:
+            return std::make_shared<BinaryMatrixComputerT<5>>(nb_gates, ch);
+        case 6:
+            return std::make_shared<BinaryMatrixComputerT<6>>(nb_gates, ch);
+        default:
+            return std::make_shared<BinaryMatrixComputer>(BinaryMatrixComputer(nb_gates, nb_qbs, ch));
+    }
+}
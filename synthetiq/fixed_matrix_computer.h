@@ -0,0 +1,39 @@
+#ifndef DEF_FIXED_MATRIX_COMPUTER
+#define DEF_FIXED_MATRIX_COMPUTER
+#include <vector>
+#include <Eigen/Dense>
+#include <iostream>
+#include <string>
+#include "gate.h"
+#include "matrix_computer.h"
+#include "arena.h"
+
+const int max_fixed_qubits = 6;
+
+template <int N>
+class BinaryMatrixComputerT : public MatrixComputer {
+    public:
+        typedef Eigen::Matrix<std::complex<double>, 1 << N, 1 << N> FixedMatrix;
+        typedef Eigen::Map<FixedMatrix, Eigen::Aligned64> Node;
+        BinaryMatrixComputerT();
+        BinaryMatrixComputerT(int nb_gates, std::shared_ptr<CircuitHelper> ch);
+        void updateMatrix(int position, const std::vector<GateId>& list_gates);
+        void calculateMatrix(const std::vector<GateId>& list_gates);
+        void initializeTree(int nb_gates);
+        void calculateLeaf(int i, const std::vector<GateId>& list_gates);
+        void calculateNode(int depth, int position);
+        Node node(int depth, int position);
+        Eigen::MatrixXcd getMatrix();
+        const std::complex<double>* getMatrixData();
+        bool rollback();
+        std::vector<std::complex<double>, ArenaAllocator<std::complex<double>>> arena; // all slots, level by level from the leaves to the root
+        std::vector<std::vector<int>> slots; // slots[d][p] is the slot in the arena of the node at depth d and position p
+        std::vector<int> spares; // spares[d] is the slot of depth d that holds no node, the previous value of the last updated node
+        static const int stride; // number of entries between two slots, a whole number of cache lines
+        int last_leaf = -1; // position of the leaf of the last update, -1 if it cannot be rolled back
+        int nb_gates;
+};
+
+std::shared_ptr<MatrixComputer> createFixedBinaryMatrixComputer(int nb_gates, int nb_qbs, std::shared_ptr<CircuitHelper> ch);
+
+#endif
@@ -21,8 +21,292 @@ Gate::Gate() {
  * @param cost The cost associated with the gate.
  */
 Gate::Gate(std::string name, Eigen::MatrixXcd matrix, std::vector<int> acting_qubits, double cost) : 
-                name(name), matrix(matrix), acting_qubits(acting_qubits), nb_qbs((int) std::log2(matrix.rows())), cost(cost) {
+                name(name), acting_qubits(acting_qubits), nb_qbs((int) std::log2(matrix.rows())), cost(cost) {
+    std::vector<int> all_qubits = {};
+    for (int i = 0; i < nb_qbs; i++) {
+        all_qubits.push_back(i);
+    }
+    setLocalFromMatrix(matrix, all_qubits);
+}
+
+/**
+ * @brief Constructs a Gate object from its local matrix.
+ * 
+ * @param name The name of the gate.
+ * @param local_matrix The matrix of the gate restricted to the qubits it acts on.
+ * @param local_qubits The qubits of the register corresponding to each bit of the local index.
+ * @param acting_qubits The qubits on which the gate acts.
+ * @param cost The cost associated with the gate.
+ * @param nb_qbs The number of qubits of the register.
+ */
+Gate::Gate(std::string name, Eigen::MatrixXcd local_matrix, std::vector<int> local_qubits, std::vector<int> acting_qubits, double cost, int nb_qbs) :
+                name(name), local_matrix(local_matrix), acting_qubits(acting_qubits), nb_qbs(nb_qbs), cost(cost) {
+    setLocalQubits(local_qubits);
+}
+
+/**
+ * @brief Sets the qubits of the register on which the local matrix acts and precomputes the corresponding offsets.
+ * 
+ * @param qubits The qubits of the register, bit b of a local index corresponds to qubit qubits[b].
+ */
+void Gate::setLocalQubits(std::vector<int> qubits) {
+    local_qubits = qubits;
+    local_mask = 0;
+    for (int qubit : local_qubits) {
+        local_mask |= 1 << qubit;
+    }
+    int local_size = 1 << local_qubits.size();
+    local_offsets = std::vector<int>(local_size, 0);
+    for (int l = 0; l < local_size; l++) {
+        for (int b = 0; b < local_qubits.size(); b++) {
+            if ((l >> b) & 1) {
+                local_offsets[l] |= 1 << local_qubits[b];
+            }
+        }
+    }
+}
+
+/**
+ * @brief Extracts the local matrix of the gate on the given qubits from its full matrix.
+ * 
+ * The full matrix is assumed to act as the identity on all qubits not in the given list. The local matrix is then of size 2^k x 2^k,
+ * where bit b of a local index corresponds to qubit qubits[b] of the register.
+ * 
+ * @param matrix The full matrix of the gate.
+ * @param qubits The qubits of the register on which the gate acts non-trivially.
+ */
+void Gate::setLocalFromMatrix(Eigen::MatrixXcd& matrix, std::vector<int> qubits) {
+    setLocalQubits(qubits);
+    int local_size = local_offsets.size();
+    local_matrix = Eigen::MatrixXcd(local_size, local_size);
+    for (int a = 0; a < local_size; a++) {
+        for (int b = 0; b < local_size; b++) {
+            local_matrix(a, b) = matrix(local_offsets[a], local_offsets[b]);
+        }
+    }
+    kind = Dense;
+}
+
+/**
+ * @brief Detects whether the gate is diagonal, a permutation or monomial (a permutation times phases), so that faster multiplications can be used.
+ * 
+ * Monomial gates store for each column b of the local matrix the row local_permutation[b] of its only non-zero entry and the value local_phases[b] of this entry.
+ * Diagonal gates additionally store their diagonal on the whole register.
+ */
+void Gate::detectKind() {
+    kind = Dense;
+    int local_size = local_matrix.rows();
+    std::vector<int> permutation(local_size, -1);
+    std::vector<std::complex<double>> phases(local_size);
+    std::vector<bool> row_used(local_size, false);
+    for (int b = 0; b < local_size; b++) {
+        for (int a = 0; a < local_size; a++) {
+            if (std::abs(local_matrix(a, b)) > structure_epsilon) {
+                if (permutation[b] != -1 || row_used[a]) {
+                    return;
+                }
+                permutation[b] = a;
+                phases[b] = local_matrix(a, b);
+                row_used[a] = true;
+            }
+        }
+        if (permutation[b] == -1) {
+            return;
+        }
+    }
+    bool identity_permutation = true;
+    bool unit_phases = true;
+    for (int b = 0; b < local_size; b++) {
+        identity_permutation = identity_permutation && permutation[b] == b;
+        unit_phases = unit_phases && std::abs(phases[b] - 1.0) < structure_epsilon;
+    }
+    local_permutation = permutation;
+    local_phases = phases;
+    if (identity_permutation) {
+        kind = Diagonal;
+        diagonal = Eigen::VectorXcd(1 << nb_qbs);
+        for (int i = 0; i < diagonal.size(); i++) {
+            diagonal(i) = phases[localIndex(i)];
+        }
+    } else if (unit_phases) {
+        kind = Permutation;
+    } else {
+        kind = Monomial;
+    }
+}
+
+/**
+ * @brief Returns the index in the local matrix corresponding to the given index of the register.
+ * 
+ * @param index The index of the register.
+ * @return The local index.
+ */
+int Gate::localIndex(int index) {
+    int local_index = 0;
+    for (int b = 0; b < local_qubits.size(); b++) {
+        if ((index >> local_qubits[b]) & 1) {
+            local_index |= 1 << b;
+        }
+    }
+    return local_index;
+}
+
+/**
+ * @brief Returns the entry of the full matrix of the gate at the given row and column.
+ * 
+ * @param row The row of the entry.
+ * @param col The column of the entry.
+ * @return The entry of the full matrix.
+ */
+std::complex<double> Gate::entry(int row, int col) {
+    if ((row ^ col) & ~local_mask) {
+        return 0.0;
+    }
+    return local_matrix(localIndex(row), localIndex(col));
+}
+
+/**
+ * @brief For a non-dense gate, returns the row of the only non-zero entry in the given column of the full matrix.
+ * 
+ * @param col The column of the full matrix.
+ * @param phase Is set to the value of the non-zero entry.
+ * @return The row of the non-zero entry.
+ */
+int Gate::monomialImage(int col, std::complex<double>& phase) {
+    int local_col = localIndex(col);
+    phase = local_phases[local_col];
+    return (col & ~local_mask) | local_offsets[local_permutation[local_col]];
+}
+
+/**
+ * @brief Returns the full matrix of the gate on the register. This is only meant to be used outside of the search, as it is not stored.
+ * 
+ * @return The full matrix of the gate.
+ */
+Eigen::MatrixXcd Gate::getMatrix() {
+    Eigen::MatrixXcd matrix = Eigen::MatrixXcd::Identity(1 << nb_qbs, 1 << nb_qbs);
+    applyLeft(matrix);
+    return matrix;
+}
+
+/**
+ * @brief Checks whether the full matrix of the gate is equal to the given matrix, up to the given tolerance on each entry.
+ * 
+ * @param matrix The matrix to compare with.
+ * @param epsilon The tolerance on each entry.
+ * @return True if the matrices are equal, false otherwise.
+ */
+bool Gate::equalsMatrix(Eigen::MatrixXcd& matrix, double epsilon) {
+    if (matrix.rows() != 1 << nb_qbs || matrix.cols() != 1 << nb_qbs) {
+        return false;
+    }
+    for (int col = 0; col < matrix.cols(); col++) {
+        for (int row = 0; row < matrix.rows(); row++) {
+            if (std::abs(matrix(row, col) - entry(row, col)) > epsilon) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Multiplies the given matrix from the left by the gate, i.e. target = gate * target.
+ * 
+ * @param target The matrix to multiply, of size 2^n x m.
+ */
+void Gate::applyLeft(Eigen::MatrixXcd& target) {
+    applyLeft(target.data(), target.rows(), target.cols());
+}
+
+/**
+ * @brief Multiplies the given column-major matrix from the left by the gate, so that fixed-size matrices can be used as well.
+ * 
+ * Only the local matrix of the gate is used: every column of the target is updated by applying the local matrix to each group of 2^k entries
+ * whose indices only differ on the acting qubits. This costs O(4^n * 2^k) instead of O(8^n) for the full product.
+ * Diagonal gates scale the rows of the target and permutation or monomial gates move (and scale) them, which costs O(4^n).
+ * 
+ * @param data The entries of the matrix to multiply, in column-major order.
+ * @param size The number of rows of the matrix, 2^n.
+ * @param cols The number of columns of the matrix.
+ */
+void Gate::applyLeft(std::complex<double>* data, int size, int cols) {
+    Eigen::Map<Eigen::MatrixXcd> target(data, size, cols);
+    int local_size = local_matrix.rows();
+    if (local_size == 1) {
+        if (local_matrix(0, 0) != 1.0) {
+            target *= local_matrix(0, 0);
+        }
+        return;
+    } else if (kind == Diagonal) {
+        target.array().colwise() *= diagonal.array();
+        return;
+    } else if (kind == Permutation || kind == Monomial) {
+        std::complex<double>* gathered = scratchBuffer(local_size);
+        for (int col = 0; col < target.cols(); col++) {
+            std::complex<double>* column = target.col(col).data();
+            for (int base = 0; base < size; base = ((base | local_mask) + 1) & ~local_mask) {
+                for (int l = 0; l < local_size; l++) {
+                    gathered[l] = column[base + local_offsets[l]];
+                }
+                if (kind == Permutation) {
+                    for (int b = 0; b < local_size; b++) {
+                        column[base + local_offsets[local_permutation[b]]] = gathered[b];
+                    }
+                } else {
+                    for (int b = 0; b < local_size; b++) {
+                        column[base + local_offsets[local_permutation[b]]] = local_phases[b] * gathered[b];
+                    }
+                }
+            }
+        }
+        return;
+    } else if (local_size == 2) {
+        // single qubit gates are by far the most common, so they get an unrolled version
+        const std::complex<double> g00 = local_matrix(0, 0), g01 = local_matrix(0, 1), g10 = local_matrix(1, 0), g11 = local_matrix(1, 1);
+        int offset = local_offsets[1];
+        for (int col = 0; col < target.cols(); col++) {
+            std::complex<double>* column = target.col(col).data();
+            for (int base = 0; base < size; base = ((base | local_mask) + 1) & ~local_mask) {
+                std::complex<double> x0 = column[base];
+                std::complex<double> x1 = column[base + offset];
+                column[base] = g00 * x0 + g01 * x1;
+                column[base + offset] = g10 * x0 + g11 * x1;
+            }
+        }
+        return;
+    }
+    std::complex<double>* gathered = scratchBuffer(local_size);
+    for (int col = 0; col < target.cols(); col++) {
+        std::complex<double>* column = target.col(col).data();
+        // iterates over all indices with zeros on the acting qubits
+        for (int base = 0; base < size; base = ((base | local_mask) + 1) & ~local_mask) {
+            for (int l = 0; l < local_size; l++) {
+                gathered[l] = column[base + local_offsets[l]];
+            }
+            for (int a = 0; a < local_size; a++) {
+                std::complex<double> value = 0.0;
+                for (int b = 0; b < local_size; b++) {
+                    value += local_matrix(a, b) * gathered[b];
+                }
+                column[base + local_offsets[a]] = value;
+            }
+        }
+    }
+}
 
+/**
+ * @brief Returns a scratch buffer of at least the given size. The buffer is kept per thread, so that applying a gate does not allocate memory.
+ * 
+ * @param size The number of entries needed.
+ * @return A pointer to the buffer, valid until the next call on the same thread.
+ */
+std::complex<double>* Gate::scratchBuffer(int size) {
+    static thread_local std::vector<std::complex<double>> buffer;
+    if (buffer.size() < size) {
+        buffer.resize(size);
+    }
+    return buffer.data();
 }
 
 /**
@@ -78,13 +362,18 @@ BasicGate::BasicGate(std::string filename) {
         acting_qubits.push_back(current_int);
     }
 
-    matrix = Eigen::MatrixXcd::Constant(std::pow(2, nb_qbs), std::pow(2, nb_qbs), 0);
+    local_matrix = Eigen::MatrixXcd::Constant(std::pow(2, nb_qbs), std::pow(2, nb_qbs), 0);
     for (int i = 0; i < std::pow(2, nb_qbs); i++) {
         for (int j = 0; j < std::pow(2, nb_qbs); j++)  {
-            file >> matrix(i, j);
+            file >> local_matrix(i, j);
         }
     }
     file.close();
+    std::vector<int> all_qubits = {};
+    for (int i = 0; i < nb_qbs; i++) {
+        all_qubits.push_back(i);
+    }
+    setLocalQubits(all_qubits);
 }
 
 /**
@@ -99,6 +388,20 @@ BasicGate::BasicGate(std::string name, Eigen::MatrixXcd matrix, std::vector<int>
     Gate(name, matrix, acting_qubits, cost) {
 }
 
+/**
+ * @brief Constructor for the BasicGate class from its local matrix.
+ * 
+ * @param name The name of the gate.
+ * @param local_matrix The matrix of the gate restricted to the qubits it acts on.
+ * @param local_qubits The qubits of the register corresponding to each bit of the local index.
+ * @param acting_qubits The qubits on which the gate acts.
+ * @param cost The cost associated with the gate.
+ * @param nb_qbs The number of qubits of the register.
+ */
+BasicGate::BasicGate(std::string name, Eigen::MatrixXcd local_matrix, std::vector<int> local_qubits, std::vector<int> acting_qubits, double cost, int nb_qbs) :
+    Gate(name, local_matrix, local_qubits, acting_qubits, cost, nb_qbs) {
+}
+
 /**
  * @brief Checks if the gate is a basic gate.
  * 
@@ -123,8 +426,8 @@ std::vector<std::shared_ptr<Gate>> BasicGate::decomposeInBasicGates() {
  * @param acting_qbs_gate A vector of integers representing the acting qubits of the gate to find.
  * @return A shared pointer to the correct Gate object if found, nullptr otherwise.
  */
-std::shared_ptr<Gate> Gate::findCorrectGate(std::vector<std::shared_ptr<Gate>> allowed_gates, std::string gate_name, std::vector<int> acting_qbs_gate) {
-    for (std::shared_ptr<Gate> allowed_gate : allowed_gates) {
+std::shared_ptr<Gate> Gate::findCorrectGate(const std::vector<std::shared_ptr<Gate>>& allowed_gates, const std::string& gate_name, const std::vector<int>& acting_qbs_gate) {
+    for (const std::shared_ptr<Gate>& allowed_gate : allowed_gates) {
         if (gate_name == allowed_gate->name && acting_qbs_gate.size() == allowed_gate->acting_qubits.size()) {
             bool good_qbs = true;
             for (int i = 0; i < acting_qbs_gate.size(); i++) {
@@ -166,6 +469,24 @@ CompositeGate::CompositeGate(std::string filename, std::vector<std::shared_ptr<G
  */
 CompositeGate::CompositeGate(std::string name, Eigen::MatrixXcd matrix, std::vector<int> acting_qubits, double cost, 
                              std::vector<std::shared_ptr<Gate>> decomposition) : Gate(name, matrix, acting_qubits, cost), decomposition(decomposition) {
+    if (decomposition.size() > 0) {
+        setLocalFromMatrix(matrix, decompositionSupport());
+    }
+}
+
+/**
+ * @brief Constructs a CompositeGate object from its local matrix, for instance when loading a compiled gate set.
+ * 
+ * @param name The name of the gate.
+ * @param local_matrix The matrix of the gate restricted to the qubits it acts on.
+ * @param local_qubits The qubits of the register corresponding to each bit of the local index.
+ * @param acting_qubits The qubits on which the gate acts.
+ * @param cost The cost associated with the gate.
+ * @param nb_qbs The number of qubits of the register.
+ * @param decomposition The decomposition of the gate into a sequence of simpler gates.
+ */
+CompositeGate::CompositeGate(std::string name, Eigen::MatrixXcd local_matrix, std::vector<int> local_qubits, std::vector<int> acting_qubits, double cost, int nb_qbs,
+                             std::vector<std::shared_ptr<Gate>> decomposition) : Gate(name, local_matrix, local_qubits, acting_qubits, cost, nb_qbs), decomposition(decomposition) {
 }
 
 /**
@@ -185,7 +506,7 @@ void CompositeGate::readFromFileTxT(std::string filename, std::vector<std::share
     cost = 0;
     decomposition = {};
     nb_qbs = allowed_gates[0]->nb_qbs;
-    matrix = Eigen::MatrixXcd::Identity(pow(2, nb_qbs), pow(2, nb_qbs));
+    Eigen::MatrixXcd matrix = Eigen::MatrixXcd::Identity(pow(2, nb_qbs), pow(2, nb_qbs));
     acting_qubits = {};
     std::string line;
     file.ignore();
@@ -206,12 +527,13 @@ void CompositeGate::readFromFileTxT(std::string filename, std::vector<std::share
         std::shared_ptr<Gate> gate_to_add = findCorrectGate(allowed_gates, gate_name, acting_qubits_gate);
         if (gate_to_add) {
                 decomposition.push_back(gate_to_add);
-                matrix = gate_to_add->matrix * matrix;
+                gate_to_add->applyLeft(matrix);
                 cost += gate_to_add->cost;
         } else {
             throw std::invalid_argument("Gate in file cannot be constructed. File: " + filename + ". Problem with line: " + line);
         }
     }
+    setLocalFromMatrix(matrix, decompositionSupport());
 }
 
 /**
@@ -244,7 +566,7 @@ void CompositeGate::readFromFileQasm(std::string filename, std::vector<std::shar
     cost = 0;
     decomposition = {};
     nb_qbs = allowed_gates[0]->nb_qbs;
-    matrix = Eigen::MatrixXcd::Identity(pow(2, nb_qbs), pow(2, nb_qbs));
+    Eigen::MatrixXcd matrix = Eigen::MatrixXcd::Identity(pow(2, nb_qbs), pow(2, nb_qbs));
 
     while (std::getline(file, line)) {
         bool found_line = false;
@@ -256,12 +578,13 @@ void CompositeGate::readFromFileQasm(std::string filename, std::vector<std::shar
         std::shared_ptr<Gate> gate_to_add = findCorrectGate(allowed_gates, gate_name, acting_qubits_gate);
         if (gate_to_add) {
                 decomposition.push_back(gate_to_add);
-                matrix = gate_to_add->matrix * matrix;
+                gate_to_add->applyLeft(matrix);
                 cost += gate_to_add->cost;
         } else {
             throw std::invalid_argument("Gate in file cannot be constructed. File: " + filename + ". Problem with line: " + line);
         }
     }
+    setLocalFromMatrix(matrix, decompositionSupport());
 }
 
 /**
@@ -293,7 +616,7 @@ std::vector<std::shared_ptr<Gate>> CompositeGate::decomposeInBasicGates() {
  * @throws std::invalid_argument If a gate in the decomposition cannot be qubit changed.
  */
 void CompositeGate::changeQubitsDecomposition(std::vector<int> qbs_change, std::vector<std::shared_ptr<Gate>> allowed_gates) {
-    matrix = Eigen::MatrixXcd::Identity(pow(2, nb_qbs), pow(2, nb_qbs));
+    Eigen::MatrixXcd matrix = Eigen::MatrixXcd::Identity(pow(2, nb_qbs), pow(2, nb_qbs));
     for (int i = 0; i < acting_qubits.size(); i++) {
         acting_qubits[i] = qbs_change[acting_qubits[i]];
     }
@@ -308,6 +631,25 @@ void CompositeGate::changeQubitsDecomposition(std::vector<int> qbs_change, std::
         } else {
             throw std::invalid_argument("Gate in file cannot be qubit changed. Name: " + name);
         }
-        matrix = new_decomp_gate->matrix * matrix;
+        new_decomp_gate->applyLeft(matrix);
+    }
+    setLocalFromMatrix(matrix, decompositionSupport());
+}
+
+/**
+ * @brief Returns the qubits on which at least one gate of the decomposition acts, in increasing order.
+ * 
+ * @return The support of the decomposition.
+ */
+std::vector<int> CompositeGate::decompositionSupport() {
+    std::vector<int> support = {};
+    for (std::shared_ptr<Gate> gate : decomposition) {
+        for (int qubit : gate->local_qubits) {
+            if (std::find(support.begin(), support.end(), qubit) == support.end()) {
+                support.push_back(qubit);
+            }
+        }
     }
+    std::sort(support.begin(), support.end());
+    return support;
 }
\ No newline at end of file
@@ -10,26 +10,52 @@
 #include <regex>
 #include <limits>
 
+enum GateKind {Dense, Diagonal, Permutation, Monomial};
+
+typedef uint16_t GateId;
+
 class Gate {
     public:
         Gate();
         Gate(std::string name, Eigen::MatrixXcd matrix, std::vector<int> acting_qubits, double cost);
+        Gate(std::string name, Eigen::MatrixXcd local_matrix, std::vector<int> local_qubits, std::vector<int> acting_qubits, double cost, int nb_qbs);
         std::string name;
-        Eigen::MatrixXcd matrix;
+        GateId id = 0; // index of the gate in the gate table of its CircuitHelper
         int nb_qbs;
         double cost;
         virtual bool isBasicGate() = 0;
         std::vector<int> acting_qubits; // qubits on which the gate acts, e.g. H on 0th qb, or on 1st qb, ...
+        Eigen::MatrixXcd local_matrix; // matrix restricted to the qubits in local_qubits, of size 2^k x 2^k
+        std::vector<int> local_qubits; // local_qubits[b] is the qubit of the register corresponding to bit b of the local index
+        std::vector<int> local_offsets; // offset in the register index of each local index
+        int local_mask = 0;
+        GateKind kind = Dense;
+        Eigen::VectorXcd diagonal; // diagonal on the whole register, only for diagonal gates
+        std::vector<int> local_permutation; // row of the non-zero entry of each local column, only for non-dense gates
+        std::vector<std::complex<double>> local_phases; // value of the non-zero entry of each local column, only for non-dense gates
+        static constexpr double structure_epsilon = 1e-12;
+        void setLocalQubits(std::vector<int> qubits);
+        void setLocalFromMatrix(Eigen::MatrixXcd& matrix, std::vector<int> qubits);
+        void detectKind();
+        int localIndex(int index);
+        std::complex<double> entry(int row, int col);
+        int monomialImage(int col, std::complex<double>& phase);
+        Eigen::MatrixXcd getMatrix();
+        bool equalsMatrix(Eigen::MatrixXcd& matrix, double epsilon = 1e-6);
+        void applyLeft(Eigen::MatrixXcd& target);
+        void applyLeft(std::complex<double>* data, int size, int cols);
         std::string print();
         virtual std::vector<std::shared_ptr<Gate>> decomposeInBasicGates() = 0;
         bool equals(Gate& other_gate);
-        static std::shared_ptr<Gate> findCorrectGate(std::vector<std::shared_ptr<Gate>> allowed_gates, std::string gate_name, std::vector<int> acting_qbs_gate);
+        static std::complex<double>* scratchBuffer(int size);
+        static std::shared_ptr<Gate> findCorrectGate(const std::vector<std::shared_ptr<Gate>>& allowed_gates, const std::string& gate_name, const std::vector<int>& acting_qbs_gate);
 };
 
 class BasicGate : public Gate {
     public:
         BasicGate(std::string filename);
         BasicGate(std::string name, Eigen::MatrixXcd matrix, std::vector<int> acting_qubits, double cost);
+        BasicGate(std::string name, Eigen::MatrixXcd local_matrix, std::vector<int> local_qubits, std::vector<int> acting_qubits, double cost, int nb_qbs);
         bool isBasicGate();
         std::vector<std::shared_ptr<Gate>> decomposeInBasicGates();
 };
@@ -38,11 +64,13 @@ class CompositeGate : public Gate {
     public:
         CompositeGate(std::string filename, std::vector<std::shared_ptr<Gate>> allowed_gates);
         CompositeGate(std::string name, Eigen::MatrixXcd matrix, std::vector<int> acting_qubits, double cost, std::vector<std::shared_ptr<Gate>> decomposition);
+        CompositeGate(std::string name, Eigen::MatrixXcd local_matrix, std::vector<int> local_qubits, std::vector<int> acting_qubits, double cost, int nb_qbs, std::vector<std::shared_ptr<Gate>> decomposition);
         std::vector<std::shared_ptr<Gate>> decomposition;
         std::vector<std::shared_ptr<Gate>> decomposeInBasicGates();
         void readFromFileTxT(std::string filename, std::vector<std::shared_ptr<Gate>> allowed_gates);
         void readFromFileQasm(std::string filename, std::vector<std::shared_ptr<Gate>> allowed_gates);
         bool isBasicGate();
+        std::vector<int> decompositionSupport();
         void changeQubitsDecomposition(std::vector<int> qbs_change, std::vector<std::shared_ptr<Gate>> allowed_gates);
 };
 
@@ -1,13 +1,27 @@
 #include "algo.h"
+#include "batch.h"
+#include <exception>
+#include <iostream>
 
 /**
- * @brief The entry point of the program.
+ * @brief The entry point of the program. With "--batch <job file>" instead of the input file, runs all jobs of the job file in this process.
  * 
  * @param argc The number of command-line arguments.
  * @param argv An array of command-line arguments.
- * @return int The exit code of the program.
+ * @return int The exit code of the program, 1 if the arguments or the input are invalid.
  */
 int main(int argc, char* argv[]) {
-    Algorithm algo = Algorithm(argc, argv);
-    algo.run();
+    try {
+        if (argc > 2 && std::string(argv[1]) == "--batch") {
+            BatchRunner batch = BatchRunner(argc, argv);
+            batch.run();
+            return 0;
+        }
+        Algorithm algo = Algorithm(argc, argv);
+        algo.run();
+    } catch (std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
 }
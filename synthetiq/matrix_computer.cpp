@@ -6,9 +6,22 @@
 #include <filesystem>
 
 /**
- * @brief Default constructor for the LinearMatrixComputer class. The linear matrix computer just computes the matrix of the circuit by multiplying the matrices of the gates.
+ * Restores the matrix before the last call of updateMatrix without recomputing it, if the matrix computer supports it.
+ * Otherwise, the caller has to call updateMatrix with the previous gates.
+ *
+ * @return True if the matrix was restored.
  */
-LinearMatrixComputer::LinearMatrixComputer() {
+bool MatrixComputer::rollback() {
+    return false;
+}
+
+/**
+ * @brief Constructor for the LinearMatrixComputer class. The linear matrix computer just computes the matrix of the circuit by multiplying the matrices of the gates.
+ * 
+ * @param ch The CircuitHelper whose gate table the gate ids refer to.
+ */
+LinearMatrixComputer::LinearMatrixComputer(std::shared_ptr<CircuitHelper> ch) {
+    this->ch = ch;
 }
 
 /**
@@ -17,7 +30,7 @@ LinearMatrixComputer::LinearMatrixComputer() {
  * @param position The position at which the circuit was updated.
  * @param list_gates The list of gates to calculate the matrix from.
  */
-void LinearMatrixComputer::updateMatrix(int position, std::vector<std::shared_ptr<Gate>> list_gates) {
+void LinearMatrixComputer::updateMatrix(int position, const std::vector<GateId>& list_gates) {
     calculateMatrix(list_gates);
 }
 
@@ -26,11 +39,11 @@ void LinearMatrixComputer::updateMatrix(int position, std::vector<std::shared_pt
  * 
  * @param list_gates The list of gates in the circuit.
  */
-void LinearMatrixComputer::calculateMatrix(std::vector<std::shared_ptr<Gate>> list_gates) {
-    int nb_qbs = list_gates[0]->nb_qbs;
+void LinearMatrixComputer::calculateMatrix(const std::vector<GateId>& list_gates) {
+    int nb_qbs = ch->nb_qbs;
     matrix = Eigen::MatrixXcd::Identity(pow(2, nb_qbs), pow(2, nb_qbs));
     for (int i = 0; i < list_gates.size(); i++) {
-        matrix = list_gates[i]->matrix * matrix;
+        ch->readable_gates[list_gates[i]]->applyLeft(matrix);
     }
 }
 
@@ -43,6 +56,15 @@ Eigen::MatrixXcd LinearMatrixComputer::getMatrix() {
     return matrix;
 }
 
+/**
+ * @brief Returns the entries of the matrix of the circuit in column-major order, without copying them.
+ * 
+ * @return A pointer to the entries of the matrix, valid until the circuit changes.
+ */
+const std::complex<double>* LinearMatrixComputer::getMatrixData() {
+    return matrix.data();
+}
+
 /**
  * Constructor for the ChunkMatrixComputer class. This computer divides the circuit into chunks and computes the matrix of each chunk. 
  * The final matrix is the product of the matrices of the chunks. Only when a position in a specific chunk is updated, the matrix of that chunk is recomputed.
@@ -56,8 +78,10 @@ ChunkMatrixComputer::ChunkMatrixComputer() {
  * 
  * @param nb_gates The number of gates.
  * @param nb_qbs The number of qubits.
+ * @param ch The CircuitHelper whose gate table the gate ids refer to.
  */
-ChunkMatrixComputer::ChunkMatrixComputer(int nb_gates, int nb_qbs): nb_gates(nb_gates), nb_qbs(nb_qbs) {
+ChunkMatrixComputer::ChunkMatrixComputer(int nb_gates, int nb_qbs, std::shared_ptr<CircuitHelper> ch): nb_gates(nb_gates), nb_qbs(nb_qbs) {
+    this->ch = ch;
     initializeChunks(nb_gates, nb_qbs);
 }
 
@@ -70,6 +94,7 @@ ChunkMatrixComputer::ChunkMatrixComputer(int nb_gates, int nb_qbs): nb_gates(nb_
 void ChunkMatrixComputer::initializeChunks(int nb_gates, int n_qubits) {
     nb_qbs = n_qubits;
     chunks = {};
+    product = Eigen::MatrixXcd(1 << nb_qbs, 1 << nb_qbs);
     int nb_chunks = (int) std::sqrt(nb_gates);
     for (int i = 0; i < nb_chunks; i++) {
         chunks.push_back(Eigen::MatrixXcd::Identity(pow(2, nb_qbs), pow(2, nb_qbs)));
@@ -86,12 +111,12 @@ void ChunkMatrixComputer::initializeChunks(int nb_gates, int n_qubits) {
  * @param position The position at which to update the matrix.
  * @param list_gates The list of gates to use for matrix computation.
  */
-void ChunkMatrixComputer::updateMatrix(int position, std::vector<std::shared_ptr<Gate>> list_gates) {
+void ChunkMatrixComputer::updateMatrix(int position, const std::vector<GateId>& list_gates) {
     int chunk_factor = std::ceil(nb_gates / (double) chunks.size());
     int chunk = std::floor(position / chunk_factor);
-    chunks[chunk] = Eigen::MatrixXcd::Identity(1 << nb_qbs, 1 << nb_qbs);
+    chunks[chunk].setIdentity();
     for (int i = chunk * chunk_factor; i < std::min((chunk + 1) * chunk_factor, (int) list_gates.size()); i++) {
-        chunks[chunk] = list_gates[i]->matrix * chunks[chunk];
+        ch->readable_gates[list_gates[i]]->applyLeft(chunks[chunk]);
     }
     matrix_computed = false;
 }
@@ -103,7 +128,7 @@ void ChunkMatrixComputer::updateMatrix(int position, std::vector<std::shared_ptr
  * 
  * @param list_gates The list of gates in the circuit.
  */
-void ChunkMatrixComputer::calculateMatrix(std::vector<std::shared_ptr<Gate>> list_gates) {
+void ChunkMatrixComputer::calculateMatrix(const std::vector<GateId>& list_gates) {
     if (list_gates.size() != nb_gates){ 
         initializeChunks(list_gates.size(), nb_qbs);
     }
@@ -120,14 +145,26 @@ void ChunkMatrixComputer::calculateMatrix(std::vector<std::shared_ptr<Gate>> lis
  * @return The matrix representation of the ChunkMatrixComputer.
  */
 Eigen::MatrixXcd ChunkMatrixComputer::getMatrix() {
+    getMatrixData();
+    return matrix;
+}
+
+/**
+ * @brief Returns the entries of the matrix of the circuit in column-major order, without copying them.
+ * The product of the chunks is only recomputed if a chunk changed.
+ * 
+ * @return A pointer to the entries of the matrix, valid until the circuit changes.
+ */
+const std::complex<double>* ChunkMatrixComputer::getMatrixData() {
     if (!matrix_computed) {
-        matrix = Eigen::MatrixXcd::Identity(1 << nb_qbs, 1 << nb_qbs);
+        matrix.setIdentity(1 << nb_qbs, 1 << nb_qbs);
         for (auto chunk = chunks.begin(); chunk < chunks.end(); chunk++) {
-            matrix = *chunk * matrix;
+            product.noalias() = *chunk * matrix;
+            matrix.swap(product);
         }
         matrix_computed = true;
     }
-    return matrix;
+    return matrix.data();
 }
 
 /**
@@ -142,66 +179,125 @@ BinaryMatrixComputer::BinaryMatrixComputer() {
  * 
  * @param n_gates The number of gates.
  * @param nb_qbs The number of qubits.
+ * @param ch The CircuitHelper whose gate table the gate ids refer to.
  */
-BinaryMatrixComputer::BinaryMatrixComputer(int n_gates, int nb_qbs): nb_gates(n_gates), nb_qbs(nb_qbs) {
+BinaryMatrixComputer::BinaryMatrixComputer(int n_gates, int nb_qbs, std::shared_ptr<CircuitHelper> ch): nb_gates(n_gates), nb_qbs(nb_qbs) {
+    this->ch = ch;
     initializeTree(n_gates, nb_qbs);
 }
 
 /**
- * Initializes the tree data structure for the BinaryMatrixComputer.
+ * Initializes the tree data structure for the BinaryMatrixComputer. The nodes are stored in a single arena, the leaves first and the root last,
+ * so that an update walks through the arena in increasing order. Every level has one spare slot, see updateMatrix.
+ * The arena and the slot lists keep their memory when the number of gates changes.
  * 
  * @param n_gates The number of gates in the circuit.
  * @param n_qubits The number of qubits in the circuit.
  */
 void BinaryMatrixComputer::initializeTree(int n_gates, int n_qubits) {
+    nb_gates = n_gates;
     nb_qbs = n_qubits;
+    dimension = 1 << nb_qbs;
+    int line = arena_alignment / sizeof(std::complex<double>);
+    stride = (dimension * dimension + line - 1) / line * line;
     int depth = std::max((int) std::ceil(std::log2(n_gates)), 1);
-    tree = {};
+    slots.resize(depth);
+    spares.resize(depth);
+    int n_slots = 0;
     for (int i = 0; i < depth; i++) {
-        tree.push_back({});
-        int size = std::ceil(n_gates / pow(2, i + 1));
+        int size = (n_gates + (2 << i) - 1) >> (i + 1);
+        slots[i].clear();
         for (int j = 0; j < size; j++) {
-            tree[i].push_back(Eigen::MatrixXcd::Identity(pow(2, nb_qbs), pow(2, nb_qbs)));
+            slots[i].push_back(n_slots++);
+        }
+        spares[i] = n_slots++;
+    }
+    arena.resize((size_t) n_slots * stride);
+    for (int i = 0; i < depth; i++) {
+        for (int j = 0; j < slots[i].size(); j++) {
+            node(i, j).setIdentity();
         }
     }
+    last_leaf = -1;
 }
 
 /**
- * Updates the binary matrix at the specified index with the given list of gates.
- * The binary matrix is updated based on the position of the gates in the list.
- * The updated matrix is stored in the tree data structure.
+ * @brief Returns the node at the given depth and position as a matrix backed by the arena.
  *
- * @param i The index at which the circuit was changed
+ * @param depth The depth of the node, 0 for the leaves.
+ * @param position The position of the node in its level.
+ * @return The node.
+ */
+BinaryMatrixComputer::Node BinaryMatrixComputer::node(int depth, int position) {
+    return Node(arena.data() + (size_t) slots[depth][position] * stride, dimension, dimension);
+}
+
+/**
+ * Calculates the leaf of the tree containing the gates at positions i and i + 1, where i is even.
+ * The leaf is built by applying the gates to the identity, so that only their local matrices are used.
+ *
+ * @param i The position of the first gate of the leaf.
  * @param list_gates The list of gates.
  */
-void BinaryMatrixComputer::updateMatrix(int i, std::vector<std::shared_ptr<Gate>> list_gates) {
-    int starting_pos = tree[0].size() - 1 - i / 2;
-    if (i % 2 == 0) {
-        if (i == list_gates.size() - 1) {
-            //note: the gates need to be turned around because the last gate is applied
-            tree[0][starting_pos] = list_gates[i]->matrix;
-        } else {
-            tree[0][starting_pos] = list_gates[i + 1]->matrix * list_gates[i]->matrix;
-        }
+void BinaryMatrixComputer::calculateLeaf(int i, const std::vector<GateId>& list_gates) {
+    Node leaf = node(0, slots[0].size() - 1 - i / 2);
+    leaf.setIdentity();
+    //note: the gates need to be turned around because the last gate is applied
+    ch->readable_gates[list_gates[i]]->applyLeft(leaf.data(), dimension, dimension);
+    if (i + 1 < list_gates.size()) {
+        ch->readable_gates[list_gates[i + 1]]->applyLeft(leaf.data(), dimension, dimension);
+    }
+}
+
+/**
+ * Calculates the node at the given depth and position from its two children.
+ *
+ * @param depth The depth of the node, at least 1.
+ * @param position The position of the node in its level.
+ */
+void BinaryMatrixComputer::calculateNode(int depth, int position) {
+    int earlier_position = 2 * position;
+    if (earlier_position == slots[depth - 1].size() - 1) {
+        node(depth, position) = node(depth - 1, earlier_position);
     } else {
-        tree[0][starting_pos] = list_gates[i]->matrix * list_gates[i - 1]->matrix;
-    }
-
-    for (int current_depth = 1; current_depth < tree.size(); current_depth++) {
-        int position = starting_pos/ pow(2, current_depth);
-        int earlier_position = starting_pos / pow(2, current_depth - 1);
-        if (earlier_position % 2 == 0) {
-            if (earlier_position == tree[current_depth - 1].size() - 1) {
-                tree[current_depth][position] = tree[current_depth - 1][earlier_position];
-            } else {
-                tree[current_depth][position] = tree[current_depth - 1][earlier_position] * tree[current_depth - 1][earlier_position + 1];
-            }
-        } else {
-            tree[current_depth][position] = tree[current_depth - 1][earlier_position - 1] * tree[current_depth - 1][earlier_position];
-        }
+        node(depth, position).noalias() = node(depth - 1, earlier_position) * node(depth - 1, earlier_position + 1);
     }
 }
 
+/**
+ * Updates the leaf containing the given position and all its ancestors. Each updated node is first exchanged with the spare slot of its level
+ * and then recalculated, so that the spare slots keep the previous path for rollback.
+ *
+ * @param i The index at which the circuit was changed
+ * @param list_gates The list of gates.
+ */
+void BinaryMatrixComputer::updateMatrix(int i, const std::vector<GateId>& list_gates) {
+    int starting_pos = slots[0].size() - 1 - i / 2;
+    std::swap(slots[0][starting_pos], spares[0]);
+    calculateLeaf(i - i % 2, list_gates);
+    for (int current_depth = 1; current_depth < slots.size(); current_depth++) {
+        std::swap(slots[current_depth][starting_pos >> current_depth], spares[current_depth]);
+        calculateNode(current_depth, starting_pos >> current_depth);
+    }
+    last_leaf = starting_pos;
+}
+
+/**
+ * Restores the path of the last update by exchanging its nodes with the spare slots again.
+ *
+ * @return True if the matrix was restored, false if there was no update since the tree was calculated or rolled back.
+ */
+bool BinaryMatrixComputer::rollback() {
+    if (last_leaf < 0) {
+        return false;
+    }
+    for (int current_depth = 0; current_depth < slots.size(); current_depth++) {
+        std::swap(slots[current_depth][last_leaf >> current_depth], spares[current_depth]);
+    }
+    last_leaf = -1;
+    return true;
+}
+
 /**
  * Calculates the matrix representation of a quantum circuit given a list of gates.
  * If the size of the list of gates is different from the expected number of gates, the tree is initialized.
@@ -209,29 +305,21 @@ void BinaryMatrixComputer::updateMatrix(int i, std::vector<std::shared_ptr<Gate>
  * 
  * @param list_gates The list of gates to be applied in the circuit.
  */
-void BinaryMatrixComputer::calculateMatrix(std::vector<std::shared_ptr<Gate>> list_gates) {
+void BinaryMatrixComputer::calculateMatrix(const std::vector<GateId>& list_gates) {
     if (list_gates.size() != nb_gates) {
         initializeTree(list_gates.size(), nb_qbs);
     }
 
     for (int i = 0; i < list_gates.size(); i += 2) {
-        if (i == list_gates.size() - 1) {
-            tree[0][tree[0].size() - 1 - i / 2] = list_gates[i]->matrix;
-        } else {
-            tree[0][tree[0].size() - 1 - i / 2] = list_gates[i + 1]->matrix * list_gates[i]->matrix;
-        }
+        calculateLeaf(i, list_gates);
     }
     
-    for (int current_depth = 1; current_depth < tree.size(); current_depth++) {
-        for (int earlier_position = 0; earlier_position < tree[current_depth - 1].size(); earlier_position += 2) {
-            int position = earlier_position / 2;
-            if (earlier_position == tree[current_depth - 1].size() - 1) {
-                tree[current_depth][position] = tree[current_depth - 1][earlier_position];
-            } else {
-                tree[current_depth][position] = tree[current_depth - 1][earlier_position] * tree[current_depth - 1][earlier_position + 1];
-            }
+    for (int current_depth = 1; current_depth < slots.size(); current_depth++) {
+        for (int position = 0; position < slots[current_depth].size(); position++) {
+            calculateNode(current_depth, position);
         }
     }
+    last_leaf = -1;
 }
 
 /**
@@ -243,5 +331,122 @@ void BinaryMatrixComputer::calculateMatrix(std::vector<std::shared_ptr<Gate>> li
  * @return The matrix representation of the BinaryMatrixComputer.
  */
 Eigen::MatrixXcd BinaryMatrixComputer::getMatrix() {
-    return tree[tree.size() - 1][0];
+    return node(slots.size() - 1, 0);
+}
+
+/**
+ * @brief Returns the entries of the matrix of the circuit in column-major order, without copying them.
+ * 
+ * @return A pointer to the entries of the matrix, valid until the circuit changes.
+ */
+const std::complex<double>* BinaryMatrixComputer::getMatrixData() {
+    return node(slots.size() - 1, 0).data();
+}
+
+/**
+ * Constructor for the SlabMatrixComputer class. This computer only computes the given columns of the matrix of the circuit, by applying the
+ * gates one after the other to the corresponding columns of the identity. The intermediate results are kept, so that an update only
+ * applies the gates from the updated position onwards. If a single column is computed, this is the state vector of the circuit.
+ * Since every gate mixes the rows, the rows cannot be restricted in the same way.
+ */
+SlabMatrixComputer::SlabMatrixComputer() {
+
+}
+
+/**
+ * @brief Constructs a SlabMatrixComputer object.
+ * 
+ * @param nb_qbs The number of qubits.
+ * @param columns The columns of the matrix to compute, for instance the columns covered by the constraints. All columns if null.
+ * @param ch The CircuitHelper whose gate table the gate ids refer to.
+ */
+SlabMatrixComputer::SlabMatrixComputer(int nb_qbs, std::shared_ptr<const std::vector<int>> columns, std::shared_ptr<CircuitHelper> ch): nb_qbs(nb_qbs) {
+    this->ch = ch;
+    int size = 1 << nb_qbs;
+    if (columns == nullptr) {
+        std::vector<int> all_columns(size);
+        for (int j = 0; j < size; j++) {
+            all_columns[j] = j;
+        }
+        columns = std::make_shared<const std::vector<int>>(all_columns);
+    }
+    this->columns = columns;
+    initial = Eigen::MatrixXcd::Zero(size, columns->size());
+    for (int k = 0; k < columns->size(); k++) {
+        initial((*columns)[k], k) = 1.0;
+    }
+    matrix = Eigen::MatrixXcd::Zero(size, size);
+}
+
+/**
+ * Updates the slabs from the given position onwards. The previous slabs are kept for rollback, exchanging them costs no copy.
+ * 
+ * @param position The position at which the circuit was updated.
+ * @param list_gates The list of gates.
+ */
+void SlabMatrixComputer::updateMatrix(int position, const std::vector<GateId>& list_gates) {
+    for (int i = position; i < list_gates.size(); i++) {
+        slabs[i].swap(previous_slabs[i]);
+        slabs[i] = i == 0 ? initial : slabs[i - 1];
+        if (!ch->gate_flags[list_gates[i]].is_identity) {
+            ch->readable_gates[list_gates[i]]->applyLeft(slabs[i]);
+        }
+    }
+    matrix_computed = false;
+    last_position = position;
+}
+
+/**
+ * Calculates the slabs of all positions.
+ * 
+ * @param list_gates The list of gates.
+ */
+void SlabMatrixComputer::calculateMatrix(const std::vector<GateId>& list_gates) {
+    slabs.resize(list_gates.size());
+    previous_slabs.resize(list_gates.size());
+    updateMatrix(0, list_gates);
+    last_position = -1;
+}
+
+/**
+ * Restores the slabs of the last update by exchanging them with the previous slabs again.
+ *
+ * @return True if the matrix was restored, false if there was no update since the slabs were calculated or rolled back.
+ */
+bool SlabMatrixComputer::rollback() {
+    if (last_position < 0) {
+        return false;
+    }
+    for (int i = last_position; i < slabs.size(); i++) {
+        slabs[i].swap(previous_slabs[i]);
+    }
+    matrix_computed = false;
+    last_position = -1;
+    return true;
+}
+
+/**
+ * @brief Returns the matrix of the circuit, whose entries outside of the computed columns are zero.
+ * 
+ * @return The matrix of the circuit restricted to the columns.
+ */
+Eigen::MatrixXcd SlabMatrixComputer::getMatrix() {
+    getMatrixData();
+    return matrix;
+}
+
+/**
+ * @brief Returns the entries of the matrix of the circuit in column-major order, whose entries outside of the computed columns are zero.
+ * 
+ * @return A pointer to the entries of the matrix, valid until the circuit changes.
+ */
+const std::complex<double>* SlabMatrixComputer::getMatrixData() {
+    if (!matrix_computed) {
+        const Eigen::MatrixXcd& last = slabs.empty() ? initial : slabs.back();
+        for (int k = 0; k < columns->size(); k++) {
+            matrix.col((*columns)[k]) = last.col(k);
+        }
+        matrix_computed = true;
+    }
+    return matrix.data();
 }
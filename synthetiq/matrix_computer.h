@@ -12,35 +12,42 @@
 #include "randomhelper.h"
 #include "gate.h"
 #include "circuithelper.h"
+#include "arena.h"
 
-enum MatrixComputerType {Linear, Chunk, Binary};
+enum MatrixComputerType {Linear, Chunk, Binary, FixedBinary, Slab};
 
 class MatrixComputer {
     public:
-        virtual void updateMatrix(int position, std::vector<std::shared_ptr<Gate>> list_gates) = 0;
-        virtual void  calculateMatrix(std::vector<std::shared_ptr<Gate>> list_gates) = 0;
+        virtual void updateMatrix(int position, const std::vector<GateId>& list_gates) = 0;
+        virtual void  calculateMatrix(const std::vector<GateId>& list_gates) = 0;
         virtual Eigen::MatrixXcd getMatrix() = 0;
+        virtual const std::complex<double>* getMatrixData() = 0;
+        virtual bool rollback();
+        std::shared_ptr<CircuitHelper> ch; // owns the gate table the gate ids refer to
 };
 
 class LinearMatrixComputer : public MatrixComputer {
     public:
-        LinearMatrixComputer();
-        void updateMatrix(int position, std::vector<std::shared_ptr<Gate>> list_gates);
-        void  calculateMatrix(std::vector<std::shared_ptr<Gate>> list_gates);
+        LinearMatrixComputer(std::shared_ptr<CircuitHelper> ch);
+        void updateMatrix(int position, const std::vector<GateId>& list_gates);
+        void  calculateMatrix(const std::vector<GateId>& list_gates);
         Eigen::MatrixXcd getMatrix();
+        const std::complex<double>* getMatrixData();
         Eigen::MatrixXcd matrix;
 };
 
 class ChunkMatrixComputer : public MatrixComputer {
     public:
         ChunkMatrixComputer();
-        ChunkMatrixComputer(int nb_gates, int nb_qbs);
-        void updateMatrix(int position, std::vector<std::shared_ptr<Gate>> list_gates);
-        void  calculateMatrix(std::vector<std::shared_ptr<Gate>> list_gates);
+        ChunkMatrixComputer(int nb_gates, int nb_qbs, std::shared_ptr<CircuitHelper> ch);
+        void updateMatrix(int position, const std::vector<GateId>& list_gates);
+        void  calculateMatrix(const std::vector<GateId>& list_gates);
         void initializeChunks(int nb_gates, int nb_qbs);
         Eigen::MatrixXcd getMatrix();
+        const std::complex<double>* getMatrixData();
         std::vector<Eigen::MatrixXcd> chunks;
         Eigen::MatrixXcd matrix;
+        Eigen::MatrixXcd product; // scratch for the product of the chunks
         bool matrix_computed = false;
         int nb_gates;
         int nb_qbs;
@@ -48,16 +55,46 @@ class ChunkMatrixComputer : public MatrixComputer {
 
 class BinaryMatrixComputer : public MatrixComputer {
     public:
+        typedef Eigen::Map<Eigen::MatrixXcd, Eigen::Aligned64> Node;
         BinaryMatrixComputer();
-        BinaryMatrixComputer(int nb_gates, int nb_qbs);
-        std::vector<std::vector<Eigen::MatrixXcd>> tree;
-        void updateMatrix(int position, std::vector<std::shared_ptr<Gate>> list_gates);
-        void calculateMatrix(std::vector<std::shared_ptr<Gate>> list_gates);
+        BinaryMatrixComputer(int nb_gates, int nb_qbs, std::shared_ptr<CircuitHelper> ch);
+        void updateMatrix(int position, const std::vector<GateId>& list_gates);
+        void calculateMatrix(const std::vector<GateId>& list_gates);
         void initializeTree(int nb_gates, int n_qubits);
+        void calculateLeaf(int i, const std::vector<GateId>& list_gates);
+        void calculateNode(int depth, int position);
+        Node node(int depth, int position);
         Eigen::MatrixXcd getMatrix();
+        const std::complex<double>* getMatrixData();
+        bool rollback();
+        std::vector<std::complex<double>, ArenaAllocator<std::complex<double>>> arena; // all slots, level by level from the leaves to the root
+        std::vector<std::vector<int>> slots; // slots[d][p] is the slot in the arena of the node at depth d and position p
+        std::vector<int> spares; // spares[d] is the slot of depth d that holds no node, the previous value of the last updated node
+        int stride = 0; // number of entries between two slots, a whole number of cache lines
+        int last_leaf = -1; // position of the leaf of the last update, -1 if it cannot be rolled back
+        int dimension = 0;
         int nb_gates;
         int nb_qbs;
 };
+
+class SlabMatrixComputer : public MatrixComputer {
+    public:
+        SlabMatrixComputer();
+        SlabMatrixComputer(int nb_qbs, std::shared_ptr<const std::vector<int>> columns, std::shared_ptr<CircuitHelper> ch);
+        void updateMatrix(int position, const std::vector<GateId>& list_gates);
+        void calculateMatrix(const std::vector<GateId>& list_gates);
+        Eigen::MatrixXcd getMatrix();
+        const std::complex<double>* getMatrixData();
+        bool rollback();
+        std::shared_ptr<const std::vector<int>> columns; // columns of the matrix that are computed
+        std::vector<Eigen::MatrixXcd> slabs; // slabs[i] is the product of the first i + 1 gates restricted to the columns
+        std::vector<Eigen::MatrixXcd> previous_slabs; // the slabs before the last update, from last_position onwards
+        int last_position = -1; // position of the last update, -1 if it cannot be rolled back
+        Eigen::MatrixXcd initial; // the identity restricted to the columns
+        Eigen::MatrixXcd matrix; // the matrix of the circuit, zero outside of the columns
+        bool matrix_computed = false;
+        int nb_qbs;
+};
     
 
 #endif
\ No newline at end of file
@@ -88,6 +88,15 @@ void MCMC::set_temp_scheme(std::shared_ptr<TemperatureScheme> t){
     temp_scheme = t;
 }
 
+/**
+ * @brief Sets the cancellation token polled by the runs of the MCMC algorithm, which then return their best circuit so far once it is cancelled.
+ * 
+ * @param c A shared pointer to the CancellationToken object, or nullptr for runs that always make all their steps.
+ */
+void MCMC::set_cancellation(std::shared_ptr<CancellationToken> c){
+    cancellation = c;
+}
+
 /**
  * @brief Returns the equality computer used by the MCMC algorithm.
  * 
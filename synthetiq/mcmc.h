@@ -6,6 +6,8 @@
 #include "mutation.h"
 #include "partialMatrix.h"
 #include "temperatureScheme.h"
+#include "cancellation.h"
+#include "stagnation.h"
 #include <map>
 #include <Eigen/Dense>
 #include <string>
@@ -19,8 +21,11 @@ const int nbTypesMonitorable = 5;
 class MCMCResult{
     public:
         std::shared_ptr<GateCircuit> circuit_best;
+        std::vector<GateId> best_gates; // gate ids of the best circuit, circuit_best is only built from them at the end of a run
         double best_energy;
         double best_eq; //from best proba hein
+        StopReason stop_reason = StopStepBudget;
+        int n_steps = 0; // step at which the run stopped
 
         MCMCResult();
         MCMCResult(std::shared_ptr<GateCircuit> circuitBest);
@@ -39,6 +44,7 @@ class MCMC{
         void set_exact_eq_comp(std::shared_ptr<EqualityComputer>e); //to change perf from default
         void set_mutator(std::shared_ptr<Mutator> m); //change mutations from default
         void set_temp_scheme(std::shared_ptr<TemperatureScheme> t);
+        void set_cancellation(std::shared_ptr<CancellationToken> c); //runs stop early once it is cancelled
         std::shared_ptr<EqualityComputer> getEqualityComputer();
         std::shared_ptr<Mutator> getMutator();
         std::shared_ptr<TemperatureScheme> getTemperatureScheme();
@@ -59,6 +65,7 @@ class MCMC{
         std::shared_ptr<Mutator> mutator;
         std::shared_ptr<TemperatureScheme> temp_scheme;
         std::shared_ptr<EqualityComputer> exact_eq_comp;
+        std::shared_ptr<CancellationToken> cancellation;
         bool enable_permutations = true;
 };
 
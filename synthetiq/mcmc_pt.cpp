@@ -0,0 +1,302 @@
+#include "mcmc_pt.h"
+#include "barrier.h"
+#include <math.h>
+#include <limits>
+#include <omp.h>
+
+const double MCMC_Pt::min_ladder_improvement = 1e-9;
+
+/**
+ * @brief Constructor for the MCMC_Pt class.
+ *
+ * @param random_helper The RandomHelper object used for seeding the replicas and for the exchanges.
+ * @param proba_id The probability of performing an identity move.
+ * @param factor_nb_steps The factor by which the number of steps of each replica is multiplied, as for MCMC_Sa.
+ * @param enable_permutations Flag indicating whether permutations are enabled.
+ * @param n_replicas The number of replicas, that is of temperatures of the ladder.
+ * @param temperature_ratio The ratio between the coldest and the hottest temperature of the ladder.
+ * @param n_threads The number of threads among which the replicas are distributed during the sweeps.
+ */
+MCMC_Pt::MCMC_Pt(RandomHelper& random_helper, double proba_id, double factor_nb_steps, bool enable_permutations, int n_replicas, double temperature_ratio, int n_threads) :
+                        MCMC(random_helper, proba_id, enable_permutations), factor_nb_steps(factor_nb_steps), n_replicas(std::max(1, n_replicas)),
+                        temperature_ratio(temperature_ratio), n_threads(std::max(1, n_threads)) {
+}
+
+/**
+ * @brief Clones the MCMC object. The replicas are not shared with the clone, which creates its own ladder on its first run.
+ *
+ * @return A shared pointer to the cloned MCMC object.
+ */
+std::shared_ptr<MCMC> MCMC_Pt::clone() {
+    std::shared_ptr<MCMC_Pt> cloned = std::make_shared<MCMC_Pt>(*this);
+    cloned->replicas.clear();
+    cloned->reseed_ladder = true;
+    cloned->set_mutator(mutator->clone());
+    cloned->set_temp_scheme(temp_scheme->clone());
+    cloned->set_eq_comp(equalitycomp->clone());
+    return cloned;
+}
+
+/**
+ * Determines whether to accept a mutation based on the Metropolis criterion.
+ *
+ * @param rd_val The random value used for acceptance probability calculation.
+ * @param candidate_energy The energy of the candidate solution.
+ * @param cur_energy The energy of the current solution.
+ * @param temperature The temperature of the replica.
+ * @return True if the mutation should be accepted, false otherwise.
+ */
+bool MCMC_Pt::acceptMutation(double rd_val, double candidate_energy, double cur_energy, double temperature) {
+    if (candidate_energy <= cur_energy) {
+        return true;
+    }
+    return rd_val <= std::exp(-(candidate_energy - cur_energy) / temperature);
+}
+
+/**
+ * @brief Sets the number of threads among which the replicas are distributed during the sweeps of the next runs, e.g. the cores a batch gives.
+ *
+ * @param n_threads The number of threads.
+ */
+void MCMC_Pt::set_n_threads(int n_threads) {
+    this->n_threads = std::max(1, n_threads);
+}
+
+/**
+ * @brief Sets whether a run continues the ladder of the previous run when that run improved it, instead of starting a new one. On ccx, new
+ * ladders find more circuits.
+ *
+ * @param continue_ladder Whether to continue improving ladders.
+ */
+void MCMC_Pt::set_continue_ladder(bool continue_ladder) {
+    this->continue_ladder = continue_ladder;
+}
+
+/**
+ * @brief Returns the temperature of a rung of the ladder of the last run.
+ *
+ * @param rung The index of the rung, 0 for the hottest.
+ * @return The temperature of the rung.
+ */
+double MCMC_Pt::getRungTemperature(int rung) {
+    return temperatures[rung];
+}
+
+/**
+ * @brief Returns the number of exchanges proposed during the last run.
+ *
+ * @return The number of proposed exchanges.
+ */
+int MCMC_Pt::getSwapsProposed() {
+    return swaps_proposed;
+}
+
+/**
+ * @brief Returns the number of exchanges accepted during the last run.
+ *
+ * @return The number of accepted exchanges.
+ */
+int MCMC_Pt::getSwapsAccepted() {
+    return swaps_accepted;
+}
+
+/**
+ * Makes the given number of Metropolis steps on a replica at the temperature of its rung. Stops early once a replica has found a circuit,
+ * in which case the circuit of that replica is left as found, or once the cancellation token is cancelled.
+ *
+ * @param replica The replica to step.
+ * @param n_steps The number of steps.
+ * @param matrix_obj The QubitIndependentPartialMatrix object representing the matrix.
+ * @param circ_helper The CircuitHelper object providing circuit-related helper functions.
+ * @param found_replica The index of the replica that found a circuit, -1 while none has, shared by all threads.
+ * @param index The index of the replica.
+ */
+void MCMC_Pt::sweep(Replica& replica, int n_steps, QubitIndependentPartialMatrix& matrix_obj, CircuitHelper& circ_helper, std::atomic<int>& found_replica, int index) {
+    double temperature = temperatures[replica.rung];
+    for (int step = 0; step < n_steps && found_replica.load(std::memory_order_relaxed) < 0; step++) {
+        if ((step & (cancellation_poll_steps - 1)) == 0 && cancellation && cancellation->poll()) {
+            return;
+        }
+        bool unchanged = mutator->mutate(*replica.circuit, *replica.random_helper);
+        if (unchanged) {
+            continue;
+        }
+        double candidate_eq_cost = equalityCost(*replica.circuit, matrix_obj, circ_helper);
+        double candidate_energy = getEnergy(candidate_eq_cost);
+        if (!acceptMutation(replica.random_helper->random01(), candidate_energy, replica.energy, temperature)) {
+            mutator->undo_mutation(*replica.circuit);
+            continue;
+        }
+        replica.energy = candidate_energy;
+        replica.eq = candidate_eq_cost;
+        if (candidate_energy < replica.best_energy) {
+            replica.best_energy = candidate_energy;
+            replica.best_eq = candidate_eq_cost;
+            replica.best_gates = replica.circuit->getGateIds();
+            if (exact_eq_comp->normalizedEqualityCost(*replica.circuit, matrix_obj, circ_helper) < 1e-3) {
+                int none = -1;
+                found_replica.compare_exchange_strong(none, index);
+                return;
+            }
+        }
+    }
+}
+
+/**
+ * Proposes to exchange the temperatures of the replicas on neighbouring rungs, for the pairs of rungs starting at the given parity.
+ * An exchange between a hotter and a colder rung is accepted with probability min(1, exp((1/T_cold - 1/T_hot) * (E_cold - E_hot))), so it is
+ * always accepted if the hotter replica has the lower energy. Only the rungs of the replicas change, their circuits stay in place.
+ *
+ * @param parity 0 for the pairs (0, 1), (2, 3), ..., 1 for the pairs (1, 2), (3, 4), ...
+ */
+void MCMC_Pt::exchange(int parity) {
+    for (int rung = parity; rung + 1 < n_replicas; rung += 2) {
+        Replica& hot = replicas[replica_at_rung[rung]];
+        Replica& cold = replicas[replica_at_rung[rung + 1]];
+        double log_acceptance = (1 / temperatures[rung + 1] - 1 / temperatures[rung]) * (cold.energy - hot.energy);
+        swaps_proposed++;
+        if (log_acceptance >= 0 || random_helper.random01() < std::exp(log_acceptance)) {
+            std::swap(hot.rung, cold.rung);
+            std::swap(replica_at_rung[rung], replica_at_rung[rung + 1]);
+            swaps_accepted++;
+        }
+    }
+}
+
+/**
+ * Puts a copy of the initial circuit of a run in a replica, with a new seed.
+ *
+ * @param replica The replica.
+ * @param init The initial circuit.
+ * @param init_eq The equality cost of the initial circuit.
+ */
+void MCMC_Pt::seedReplica(Replica& replica, std::shared_ptr<GateCircuit> init, double init_eq) {
+    replica.random_helper->seed(random_helper.randomInt(std::numeric_limits<int>::max()));
+    replica.circuit = init->clone();
+    replica.energy = getEnergy(init_eq);
+    replica.eq = init_eq;
+}
+
+/**
+ * Runs the MCMC algorithm with parallel tempering. A run starts all replicas from the initial circuit, unless continue_ladder is set and
+ * the previous run lowered the best energy of the ladder without finding a circuit, in which case the run continues its ladder.
+ * The replicas then make factor_nb_steps sweeps of their circuit, with an exchange of temperatures after each sweep, alternating between the
+ * even and the odd pairs of rungs. The run stops as soon as one replica finds a circuit or the cancellation token is cancelled.
+ *
+ * @param matrix_obj The QubitIndependentPartialMatrix object representing the matrix, the same for all runs of the object.
+ * @param init The initial GateCircuit object.
+ * @param circ_helper The CircuitHelper object providing circuit-related helper functions.
+ * @param debug Flag indicating whether to log debug information, about the replica on the coldest rung.
+ * @param debug_folder The folder to log debug information to.
+ * @return The MCMCResult object containing the best circuit over all replicas.
+ */
+MCMCResult MCMC_Pt::run(QubitIndependentPartialMatrix& matrix_obj, std::shared_ptr<GateCircuit> init, CircuitHelper& circ_helper,
+                         bool debug, std::string debug_folder) {
+    MCMCResult res;
+    std::ofstream file;
+    if (debug) {
+        file.open(find_next_available_file(debug_folder));
+    }
+    // the temperature scheme can change between runs, e.g. for warm starts, the rungs keep their position on the ladder
+    temp_scheme->reset();
+    temperatures = std::vector<double>(n_replicas);
+    for (int rung = 0; rung < n_replicas; rung++) {
+        double position = n_replicas > 1 ? rung / (n_replicas - 1.0) : 0.0;
+        temperatures[rung] = temp_scheme->getTemperature() * std::pow(temperature_ratio, position);
+    }
+    if (replicas.size() != n_replicas) {
+        replicas = std::vector<Replica>(n_replicas);
+        for (Replica& replica : replicas) {
+            replica.random_helper = std::make_shared<RandomHelper>();
+        }
+        reseed_ladder = true;
+    }
+    if (reseed_ladder) {
+        double init_eq = equalityCost(*init, matrix_obj, circ_helper);
+        replica_at_rung = std::vector<int>(n_replicas);
+        for (int i = 0; i < n_replicas; i++) {
+            replicas[i].rung = i;
+            replica_at_rung[i] = i;
+            seedReplica(replicas[i], init, init_eq);
+        }
+    }
+    // the best circuits of a run are the ones it reaches, from where its replicas start
+    double start_energy = std::numeric_limits<double>::max();
+    for (Replica& replica : replicas) {
+        replica.best_energy = replica.energy;
+        replica.best_eq = replica.eq;
+        replica.best_gates = replica.circuit->getGateIds();
+        start_energy = std::min(start_energy, replica.energy);
+    }
+    swaps_proposed = 0;
+    swaps_accepted = 0;
+
+    std::atomic<int> found_replica(-1);
+    int n_sweeps = std::ceil(factor_nb_steps);
+    int cur_sweep = 0;
+    bool sweeping = n_sweeps > 0 && !(cancellation && cancellation->isCancelled());
+    // the length of a sweep follows the number of gates drawn for the run, also for a ladder that continues
+    int n_steps = init->nbElements();
+    std::atomic<int> next_replica(0);
+    // the threads stay in one parallel region for the whole run and sleep on the barrier between two sweeps, instead of spinning on the
+    // barrier of a parallel loop per sweep while the exchanges are made
+    Barrier barrier;
+    #pragma omp parallel num_threads(n_threads) if(n_threads > 1 && sweeping)
+    {
+        #pragma omp single
+        barrier.reset(omp_get_num_threads());
+        while (sweeping) {
+            for (int i = next_replica++; i < n_replicas; i = next_replica++) {
+                sweep(replicas[i], n_steps, matrix_obj, circ_helper, found_replica, i);
+            }
+            if (barrier.wait()) {
+                if (found_replica.load() < 0) {
+                    exchange(cur_sweep % 2);
+                }
+                if (debug) {
+                    Replica& coldest = replicas[replica_at_rung[n_replicas - 1]];
+                    MCMCResult coldest_result;
+                    coldest_result.best_energy = coldest.best_energy;
+                    coldest_result.best_eq = coldest.best_eq;
+                    log_debug_information(*coldest.circuit, matrix_obj, coldest_result, file, circ_helper);
+                }
+                cur_sweep++;
+                next_replica = 0;
+                sweeping = cur_sweep < n_sweeps && found_replica.load() < 0 && !(cancellation && cancellation->isCancelled());
+            }
+            barrier.wait();
+        }
+    }
+
+    int best = found_replica.load();
+    if (best < 0) {
+        best = 0;
+        for (int i = 1; i < n_replicas; i++) {
+            if (replicas[i].best_energy < replicas[best].best_energy) {
+                best = i;
+            }
+        }
+    }
+    // a ladder that no longer improves is stuck in a local minimum, the next run starts a new one. The least improvement is above the
+    // rounding noise of the energies, which would otherwise keep stuck ladders
+    reseed_ladder = !continue_ladder || start_energy - replicas[best].best_energy <= min_ladder_improvement;
+    res.best_energy = replicas[best].best_energy;
+    res.best_eq = replicas[best].best_eq;
+    res.best_gates = replicas[best].best_gates;
+    if (found_replica.load() >= 0) {
+        res.stop_reason = StopFound;
+        res.circuit_best = replicas[best].circuit;
+        reseed_ladder = true;
+        correctResultQubitIndependence(res, matrix_obj, circ_helper);
+    } else {
+        if (cancellation && cancellation->isCancelled()) {
+            res.stop_reason = StopCancelled;
+        }
+        res.circuit_best = replicas[best].circuit->clone(res.best_gates);
+    }
+
+    if (debug) {
+        file.close();
+    }
+    return res;
+}
@@ -0,0 +1,63 @@
+#ifndef DEF_MCMC_PT
+#define DEF_MCMC_PT
+#include "circuit.h"
+#include "cost.h"
+#include "randomhelper.h"
+#include "mutation.h"
+#include "mcmc.h"
+#include "partialMatrix.h"
+#include "temperatureScheme.h"
+#include <atomic>
+#include <memory>
+#include <vector>
+
+class MCMC_Pt : public MCMC {
+    // parallel tempering: a ladder of replicas of the circuit at fixed temperatures, from the start temperature of the temperature scheme
+    // down to temperature_ratio times it. The replicas make one sweep of their circuit at their temperature, in parallel, and neighbouring
+    // rungs then exchange their temperatures with the Metropolis criterion on their energies, so that low-energy circuits found at high
+    // temperature move down the ladder instead of being discarded with the run. Every run starts a new ladder from its initial circuit, or,
+    // with continue_ladder, a ladder that still improves is kept for the next run, which then ignores its initial circuit.
+    public:
+        MCMC_Pt(RandomHelper& random_helper, double proba_id=0.1, double factor_nb_steps=375.0, bool enable_permutations=true,
+                int n_replicas=4, double temperature_ratio=0.1, int n_threads=1);
+
+        MCMCResult run(QubitIndependentPartialMatrix& matrix_obj, std::shared_ptr<GateCircuit> init, CircuitHelper& circ_helper, bool debug=false, std::string debug_folder="debug/");
+        std::shared_ptr<MCMC> clone();
+        bool acceptMutation(double rd_val, double candidate_energy, double cur_energy, double temperature);
+        void set_n_threads(int n_threads);
+        void set_continue_ladder(bool continue_ladder);
+        double getRungTemperature(int rung);
+        int getSwapsProposed();
+        int getSwapsAccepted();
+
+    private:
+        struct Replica {
+            std::shared_ptr<GateCircuit> circuit;
+            std::shared_ptr<RandomHelper> random_helper; // replicas are stepped by different threads, so each has its own generator
+            int rung = 0; // index of the temperature of the replica in temperatures
+            double energy = 0;
+            double eq = 0; // equality cost of the circuit
+            double best_energy = 0;
+            double best_eq = 0;
+            std::vector<GateId> best_gates;
+        };
+
+        void sweep(Replica& replica, int n_steps, QubitIndependentPartialMatrix& matrix_obj, CircuitHelper& circ_helper, std::atomic<int>& found_replica, int index);
+        void exchange(int parity);
+        void seedReplica(Replica& replica, std::shared_ptr<GateCircuit> init, double init_eq);
+
+        static const double min_ladder_improvement; // least decrease of the best energy of a run for the next run to continue its ladder
+        const double factor_nb_steps;
+        int n_replicas;
+        double temperature_ratio;
+        int n_threads;
+        std::vector<Replica> replicas;
+        std::vector<double> temperatures; // temperature of each rung, the hottest first
+        std::vector<int> replica_at_rung;
+        int swaps_proposed = 0;
+        int swaps_accepted = 0;
+        bool continue_ladder = false;
+        bool reseed_ladder = true; // whether the replicas start from the initial circuit of the next run, or continue the ladder
+};
+
+#endif
@@ -23,7 +23,8 @@ MCMC_Sa::MCMC_Sa(RandomHelper& random_helper, double proba_id, double factor_nb_
  * @return A shared pointer to the cloned MCMC object.
  */
 std::shared_ptr<MCMC> MCMC_Sa::clone() {
-    std::shared_ptr<MCMC> cloned = std::make_shared<MCMC_Sa>(*this);
+    std::shared_ptr<MCMC_Sa> cloned = std::make_shared<MCMC_Sa>(*this);
+    cloned->working = nullptr;
     cloned->set_mutator(mutator->clone());
     cloned->set_temp_scheme(temp_scheme->clone());
     cloned->set_eq_comp(equalitycomp->clone());
@@ -62,6 +63,36 @@ bool MCMC_Sa::acceptMutation(double rd_val, double candidate_energy, double cur_
     return rd_val <= proba;
 }
 
+/**
+ * Enables the environment cost oracle. It is also enabled if the mutator is a HeatBathMutator. If the covers of the targets consist of full columns or full rows, the positions of the mutations
+ * are swept in order and the cost of each proposal is computed by the EnvironmentCostOracle instead of updating the circuit matrix.
+ *
+ * @param use_environment_cost Whether the oracle is used when it is supported.
+ */
+void MCMC_Sa::set_environment_cost(bool use_environment_cost) {
+    this->use_environment_cost = use_environment_cost;
+}
+
+/**
+ * Enables the racing of the permuted targets. Instead of the minimum cost over all permuted targets, every step only evaluates the leaders
+ * of a PermutationRace, which are scanned again every few sweeps of the circuit or when the cost of the chain stalls. The check whether a circuit
+ * is found still considers all targets. Not used with the environment cost oracle, which evaluates all targets at the same cost.
+ *
+ * @param permutation_racing Whether the permuted targets are raced.
+ */
+void MCMC_Sa::set_permutation_racing(bool permutation_racing) {
+    this->permutation_racing = permutation_racing;
+}
+
+/**
+ * Sets the detector that stops runs early once they stagnate, see StagnationDetector. The default detector is disabled.
+ *
+ * @param stagnation The detector, copied for the runs of this object.
+ */
+void MCMC_Sa::set_stagnation(StagnationDetector stagnation) {
+    this->stagnation = stagnation;
+}
+
 /**
  * Calculates the index of the closest matrix in the given QubitIndependentPartialMatrix to the given GateCircuit.
  * The closeness is determined based on the equality cost between the matrices.
@@ -85,7 +116,8 @@ int MCMC_Sa::calculateClosestMatrix(QubitIndependentPartialMatrix& matrix_obj, G
 }
 
 /**
- * Runs the MCMC algorithm using the Simulated Annealing variant.
+ * Runs the MCMC algorithm using the Simulated Annealing variant. The run stops early, with its best circuit so far, once the cancellation token is cancelled
+ * or once the stagnation detector finds that it no longer makes progress. The result records why the run stopped.
  * 
  * @param matrix_obj The QubitIndependentPartialMatrix object representing the matrix.
  * @param init The initial GateCircuit object.
@@ -103,48 +135,118 @@ MCMCResult MCMC_Sa::run(QubitIndependentPartialMatrix& matrix_obj, std::shared_p
         debug_file = find_next_available_file(debug_folder);
         file.open(debug_file);
     }
-    std::shared_ptr<GateCircuit> candidate_circuit = init->clone();
+    if (working) {
+        working->copyFrom(*init);
+    } else {
+        working = init->clone();
+    }
+    std::shared_ptr<GateCircuit> candidate_circuit = working;
     res.best_eq = equalityCost(*init, matrix_obj, circ_helper); //~= 1    
     double cur_energy = getEnergy(res.best_eq);
     res.best_energy = cur_energy;
-    res.circuit_best = candidate_circuit->clone();
+    // only the gates of the best circuit are recorded during the run, the circuit is built once at the end
+    res.best_gates = init->getGateIds();
     int n_accepted_mutations = 0;
     temp_scheme->reset();
     bool found = false;
+    EnvironmentCostOracle oracle;
+    bool use_oracle = false;
+    std::shared_ptr<HeatBathMutator> heat_bath = std::dynamic_pointer_cast<HeatBathMutator>(mutator);
+    if (use_environment_cost || heat_bath) {
+        oracle = EnvironmentCostOracle(matrix_obj, enable_permutations);
+        use_oracle = oracle.isSupported();
+    }
+    // the heat bath scores all gates with the oracle, without it the mutator falls back to proposals with the Metropolis criterion
+    bool use_heat_bath = heat_bath && use_oracle;
+    std::shared_ptr<CircuitHelper> gate_table = candidate_circuit->getCircuitHelper();
+    PermutationRace race;
+    bool use_race = permutation_racing && enable_permutations && !use_oracle && matrix_obj.matrices.size() > 2;
+    if (use_race) {
+        // the leaders are the closest targets to the initial circuit, so the cost of the initial circuit does not change
+        race = PermutationRace(matrix_obj.matrices.size(), 4 * init->nbElements(), init->nbElements());
+        race.rescan(*candidate_circuit, matrix_obj, *equalitycomp);
+    }
+    stagnation.reset(res.best_energy, init->nbElements());
 
-    for (int cur_step = 0; cur_step < factor_nb_steps * init->nbElements(); cur_step++) {
+    int cur_step = 0;
+    for (; cur_step < factor_nb_steps * init->nbElements(); cur_step++) {
+        if ((cur_step & (cancellation_poll_steps - 1)) == 0 && cancellation && cancellation->poll()) {
+            res.stop_reason = StopCancelled;
+            break;
+        }
         temp_scheme->updateTemperature(cur_step, n_accepted_mutations, init->nbElements());
-        bool unchanged = mutator->mutate(*candidate_circuit, random_helper);
-        if (unchanged) {
-            continue;
+        double candidate_eq_cost;
+        int position = 0;
+        GateId proposal = 0;
+        if (use_oracle) {
+            // the positions are swept in order, so that the oracle moves its environments by one gate per step
+            position = cur_step % init->nbElements();
+            oracle.moveTo(*candidate_circuit, position);
+            if (use_heat_bath) {
+                proposal = heat_bath->sample_gate(*candidate_circuit, oracle, *equalitycomp, temp_scheme->getTemperature(), random_helper, candidate_eq_cost);
+            } else {
+                proposal = mutator->draw_gate(*candidate_circuit, random_helper);
+            }
+            if (proposal == candidate_circuit->getGateIds()[position]) {
+                continue;
+            }
+            if (!use_heat_bath) {
+                candidate_eq_cost = oracle.cost(gate_table->readable_gates[proposal], *equalitycomp);
+            }
+        } else {
+            bool unchanged = mutator->mutate(*candidate_circuit, random_helper);
+            if (unchanged) {
+                continue;
+            }
+            if (use_race) {
+                candidate_eq_cost = race.cost(*candidate_circuit, matrix_obj, *equalitycomp);
+            } else {
+                candidate_eq_cost = equalityCost(*candidate_circuit, matrix_obj, circ_helper);
+            }
         }
 
-        double candidate_eq_cost = equalityCost(*candidate_circuit, matrix_obj, circ_helper);
         double candidate_energy = getEnergy(candidate_eq_cost);
-        double u = random_helper.random01();
-        if (acceptMutation(u, candidate_energy, cur_energy, temp_scheme->getTemperature())) { //candidate accepted
-            
+        double u = use_heat_bath ? 0.0 : random_helper.random01();
+        // gates sampled from the heat bath are always accepted
+        bool accepted = use_heat_bath || acceptMutation(u, candidate_energy, cur_energy, temp_scheme->getTemperature());
+        if (accepted) { //candidate accepted
+            if (use_oracle) {
+                candidate_circuit->placeGateAt(position, proposal);
+            }
             n_accepted_mutations++;
             if (candidate_energy < res.best_energy)
             {   
                 res.best_energy = candidate_energy;
-                res.circuit_best = candidate_circuit->clone();
+                res.best_gates = candidate_circuit->getGateIds();
                 res.best_eq = candidate_eq_cost; //~= 1
-                if (exact_eq_comp->normalizedEqualityCost(*res.circuit_best, matrix_obj, circ_helper) < 1e-3) { // we assume cost is 0 for found and otherwise higher
+                if (exact_eq_comp->normalizedEqualityCost(*candidate_circuit, matrix_obj, circ_helper) < 1e-3) { // we assume cost is 0 for found and otherwise higher
                     found = true;
+                    res.stop_reason = StopFound;
                     break;
                 }
             }
 
             cur_energy = candidate_energy;
-        } else {
+        } else if (!use_oracle) {
             mutator->undo_mutation(*candidate_circuit);
         }
+        if (use_race && race.step(cur_energy)) {
+            race.rescan(*candidate_circuit, matrix_obj, *equalitycomp);
+            cur_energy = getEnergy(race.cost(*candidate_circuit, matrix_obj, *equalitycomp));
+        }
         if (debug) {
             log_debug_information(*candidate_circuit, matrix_obj, res, file, circ_helper);
         }
+        if (stagnation.step(accepted, res.best_energy, temp_scheme->getTemperature())) {
+            res.stop_reason = stagnation.getReason();
+            break;
+        }
     }
+    res.n_steps = cur_step;
+    res.circuit_best = found ? candidate_circuit : candidate_circuit->clone(res.best_gates);
     if (found) {
+        // the found circuit is handed out, the next run mutates a new one
+        working = nullptr;
         correctResultQubitIndependence(res, matrix_obj, circ_helper);
     }
     
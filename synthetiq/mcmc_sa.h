@@ -7,6 +7,9 @@
 #include "mcmc.h"
 #include "partialMatrix.h"
 #include "temperatureScheme.h"
+#include "environment_cost.h"
+#include "permutation_race.h"
+#include "stagnation.h"
 #include <map>
 #include <Eigen/Dense>
 #include <string>
@@ -25,8 +28,15 @@ class MCMC_Sa : public MCMC{
         double getProbability(GateCircuit& circ, QubitIndependentPartialMatrix& matrix_obj, CircuitHelper& circ_helper, double temperature);
         bool acceptMutation(double rd_val, double candidate_energy, double cur_energy, double temperature);
         int calculateClosestMatrix(QubitIndependentPartialMatrix& matrix_obj, GateCircuit& circ, CircuitHelper& circ_helper);
+        void set_environment_cost(bool use_environment_cost);
+        void set_permutation_racing(bool permutation_racing);
+        void set_stagnation(StagnationDetector stagnation);
     private:
         const double factor_nb_steps;
+        bool use_environment_cost = false;
+        bool permutation_racing = false;
+        StagnationDetector stagnation;
+        std::shared_ptr<GateCircuit> working; // circuit mutated by the runs, kept between runs so that its matrix computer keeps its memory
 };
 
 #endif
\ No newline at end of file
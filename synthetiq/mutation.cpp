@@ -33,6 +33,17 @@ bool Mutator::mutate_at_pos(GateCircuit& candidate, int position, RandomHelper&
     return candidate.mutate(rh, position, proportional_prob, proba_id, proba_name);
 }
 
+/**
+ * Draws the gate a mutation would place, without changing the circuit.
+ * 
+ * @param candidate The GateCircuit whose gate table is used.
+ * @param rh The RandomHelper object used for generating random numbers.
+ * @return The id of the drawn gate.
+ */
+GateId Mutator::draw_gate(GateCircuit& candidate, RandomHelper& rh) {
+    return candidate.drawGate(rh, proportional_prob, proba_id, proba_name);
+}
+
 /**
  * Applies the mutation again from one GateCircuit to another.
  * 
@@ -51,3 +62,62 @@ void Mutator::apply_mutation_again(GateCircuit& copyMutationFrom, GateCircuit& a
 std::shared_ptr<Mutator> Mutator::clone() {
     return std::make_shared<Mutator>(*this);
 }
+
+
+/**
+ * @brief Clones the HeatBathMutator object.
+ * 
+ * @return A shared pointer to a new HeatBathMutator object that is a copy of the current object.
+ */
+std::shared_ptr<Mutator> HeatBathMutator::clone() {
+    return std::make_shared<HeatBathMutator>(*this);
+}
+
+/**
+ * Samples the gate at the position of the oracle from the distribution proportional to p(g) * exp(-cost(g) / temperature), where p(g) is
+ * the probability of drawing g in a mutation and cost(g) the equality cost of the circuit with g at the position.
+ * 
+ * @param candidate The GateCircuit, whose gates other than the one at the position of the oracle are fixed.
+ * @param oracle The EnvironmentCostOracle, placed at the position to sample.
+ * @param equality_computer The equality computer providing the cost formula.
+ * @param temperature The current temperature, the gate with the lowest cost is chosen if it is not positive.
+ * @param rh The RandomHelper object used for generating random numbers.
+ * @param cost Is set to the equality cost of the circuit with the sampled gate.
+ * @return The id of the sampled gate.
+ */
+GateId HeatBathMutator::sample_gate(GateCircuit& candidate, EnvironmentCostOracle& oracle, EqualityComputer& equality_computer, double temperature, RandomHelper& rh, double& cost) {
+    const std::vector<std::shared_ptr<Gate>>& gates = candidate.getCircuitHelper()->all_gates;
+    if (prior.size() != candidate.getCircuitHelper()->readable_gates.size()) {
+        candidate.gateProbabilities(prior, proportional_prob, proba_id, proba_name);
+    }
+    costs.resize(gates.size());
+    weights.resize(gates.size());
+    int best = 0;
+    for (int i = 0; i < gates.size(); i++) {
+        costs[i] = prior[gates[i]->id] > 0 ? oracle.cost(gates[i], equality_computer) : INFINITY;
+        if (costs[i] < costs[best]) {
+            best = i;
+        }
+    }
+    if (temperature <= 0) {
+        cost = costs[best];
+        return gates[best]->id;
+    }
+    // costs are shifted by the lowest one so that the weights do not underflow
+    double total_weight = 0;
+    for (int i = 0; i < gates.size(); i++) {
+        weights[i] = prior[gates[i]->id] * std::exp(-(costs[i] - costs[best]) / temperature);
+        total_weight += weights[i];
+    }
+    double u = rh.random01() * total_weight;
+    int chosen = best;
+    for (int i = 0; i < gates.size(); i++) {
+        if (u < weights[i]) {
+            chosen = i;
+            break;
+        }
+        u -= weights[i];
+    }
+    cost = costs[chosen];
+    return gates[chosen]->id;
+}
@@ -3,6 +3,8 @@
 
 #include "circuit.h"
 #include "randomhelper.h"
+#include "cost.h"
+#include "environment_cost.h"
 #include <Eigen/Dense>
 
 class Mutator{
@@ -10,10 +12,12 @@ class Mutator{
     //or call apply_mutation again to apply the same mutation to another circuit
     public:
         Mutator(double proba_id=0.2, double proportional_prob=0.2, double proba_name=0.5): proba_id(proba_id), proportional_prob(proportional_prob), proba_name(proba_name) {};
-        Mutator(Mutator const& other) : proba_id(other.proba_id), proportional_prob(other.proportional_prob) {};
-        std::shared_ptr<Mutator> clone();
+        Mutator(Mutator const& other) : proba_id(other.proba_id), proportional_prob(other.proportional_prob), proba_name(other.proba_name) {};
+        virtual ~Mutator() {};
+        virtual std::shared_ptr<Mutator> clone();
         bool mutate(GateCircuit& candidate, RandomHelper& rh); 
         bool mutate_at_pos(GateCircuit& candidate, int position, RandomHelper& rh); 
+        GateId draw_gate(GateCircuit& candidate, RandomHelper& rh);
         void undo_mutation(GateCircuit& candidate);
         void apply_mutation_again(GateCircuit& copyMutationFrom, GateCircuit& applyMutationTo);
     protected:
@@ -22,4 +26,18 @@ class Mutator{
         double proba_name;
 };
 
+class HeatBathMutator : public Mutator {
+    //usage: call sample_gate to draw the gate at a position from the Boltzmann distribution over all gates, weighted by the probabilities of
+    //the gates in the mutations. The costs of all gates are computed at once by an EnvironmentCostOracle placed at the position.
+    public:
+        HeatBathMutator(double proba_id=0.2, double proportional_prob=0.2, double proba_name=0.5): Mutator(proba_id, proportional_prob, proba_name) {};
+        HeatBathMutator(HeatBathMutator const& other) : Mutator(other) {};
+        std::shared_ptr<Mutator> clone();
+        GateId sample_gate(GateCircuit& candidate, EnvironmentCostOracle& oracle, EqualityComputer& equality_computer, double temperature, RandomHelper& rh, double& cost);
+    private:
+        std::vector<double> prior;
+        std::vector<double> costs;
+        std::vector<double> weights;
+};
+
 #endif
\ No newline at end of file
@@ -0,0 +1,152 @@
+#include "packed_targets.h"
+
+/**
+ * Constructor for the PackedTargets class. The targets are packed on the entries covered by at least one of them, with the real and
+ * imaginary parts stored separately, so that the inner products of the circuit matrix with all targets are a single dense product that
+ * Eigen vectorizes. Targets with the same cover share the squared norm of the circuit on it.
+ *
+ * @param targets The partial matrices, whose entries outside of their cover are zero.
+ */
+PackedTargets::PackedTargets(std::vector<std::shared_ptr<PartialMatrix>>& targets) {
+    int n_entries_total = targets[0]->cover.size();
+    std::vector<bool> covered(n_entries_total, false);
+    for (const std::shared_ptr<PartialMatrix>& target : targets) {
+        const bool* cover = target->cover.data();
+        for (int index = 0; index < n_entries_total; index++) {
+            covered[index] = covered[index] || cover[index];
+        }
+    }
+    for (int index = 0; index < n_entries_total; index++) {
+        if (covered[index]) {
+            entries.push_back(index);
+        }
+    }
+
+    int n_entries = entries.size();
+    weights = RowMatrixXd::Zero(targets.size(), 2 * n_entries);
+    std::vector<int> group_representative = {};
+    std::unordered_map<std::vector<bool>, int> group_of_cover = {};
+    for (int t = 0; t < targets.size(); t++) {
+        const bool* cover = targets[t]->cover.data();
+        const std::complex<double>* matrix = targets[t]->matrix.data();
+        for (int e = 0; e < n_entries; e++) {
+            weights(t, e) = matrix[entries[e]].real();
+            weights(t, n_entries + e) = matrix[entries[e]].imag();
+        }
+        squared_norms.push_back(targets[t]->squared_norm);
+        normalization_csts.push_back(targets[t]->cover.count());
+
+        auto group = group_of_cover.emplace(std::vector<bool>(cover, cover + n_entries_total), group_representative.size());
+        if (group.second) {
+            group_representative.push_back(t);
+        }
+        cover_group.push_back(group.first->second);
+    }
+
+    cover_masks = RowMatrixXd::Zero(group_representative.size(), n_entries);
+    for (int g = 0; g < group_representative.size(); g++) {
+        const bool* cover = targets[group_representative[g]]->cover.data();
+        for (int e = 0; e < n_entries; e++) {
+            cover_masks(g, e) = cover[entries[e]] ? 1.0 : 0.0;
+        }
+    }
+}
+
+// scratch space of the packed circuit matrix, see packCircuit
+static thread_local Eigen::VectorXd packed_real;
+static thread_local Eigen::VectorXd packed_imag;
+static thread_local Eigen::VectorXd squared_circ;
+static thread_local Eigen::VectorXd inner_real;
+static thread_local Eigen::VectorXd inner_imag;
+static thread_local Eigen::VectorXd circ_sizes;
+
+/**
+ * Gathers the covered entries of the circuit matrix x into the vectors (x_re, x_im) and (x_im, -x_re), and their squared norms.
+ * For a target m, the inner product sum of conj(m) * x has real part m_re . x_re + m_im . x_im and imaginary part m_re . x_im - m_im . x_re,
+ * so both are the product of the weights of the target with one of the two vectors.
+ *
+ * @param matr_circ The entries of the circuit matrix in column-major order.
+ */
+void PackedTargets::packCircuit(const std::complex<double>* matr_circ) {
+    int n_entries = entries.size();
+    packed_real.resize(2 * n_entries);
+    packed_imag.resize(2 * n_entries);
+    squared_circ.resize(n_entries);
+    for (int e = 0; e < n_entries; e++) {
+        const std::complex<double>& value = matr_circ[entries[e]];
+        packed_real(e) = value.real();
+        packed_real(n_entries + e) = value.imag();
+        packed_imag(e) = value.imag();
+        packed_imag(n_entries + e) = -value.real();
+        squared_circ(e) = std::norm(value);
+    }
+}
+
+/**
+ * Calculates the equality costs of the circuit matrix for all targets, reading the circuit matrix once.
+ *
+ * @param matr_circ The entries of the circuit matrix in column-major order.
+ * @param equality_computer The equality computer providing the cost formula, see EqualityComputer::costFromSums.
+ * @param costs Is set to the equality cost of each target.
+ */
+void PackedTargets::costs(const std::complex<double>* matr_circ, EqualityComputer& equality_computer, std::vector<double>& costs) {
+    packCircuit(matr_circ);
+    inner_real.noalias() = weights * packed_real;
+    inner_imag.noalias() = weights * packed_imag;
+    circ_sizes.noalias() = cover_masks * squared_circ;
+    costs.resize(cover_group.size());
+    for (int t = 0; t < cover_group.size(); t++) {
+        std::complex<double> conj(inner_real(t), inner_imag(t));
+        costs[t] = equality_computer.costFromSums(squared_norms[t], normalization_csts[t], circ_sizes(cover_group[t]), conj);
+    }
+}
+
+/**
+ * Calculates the minimum equality cost of the circuit matrix over all targets, reading the circuit matrix once.
+ *
+ * @param matr_circ The entries of the circuit matrix in column-major order.
+ * @param equality_computer The equality computer providing the cost formula, see EqualityComputer::costFromSums.
+ * @return The minimum equality cost.
+ */
+double PackedTargets::minimumCost(const std::complex<double>* matr_circ, EqualityComputer& equality_computer) {
+    static thread_local std::vector<double> all_costs;
+    costs(matr_circ, equality_computer, all_costs);
+    return *std::min_element(all_costs.begin(), all_costs.end());
+}
+
+/**
+ * Calculates the minimum equality cost of the circuit matrix over the given targets only.
+ *
+ * @param matr_circ The entries of the circuit matrix in column-major order.
+ * @param equality_computer The equality computer providing the cost formula, see EqualityComputer::costFromSums.
+ * @param targets The indices of the targets to consider.
+ * @return The minimum equality cost over the targets.
+ */
+double PackedTargets::minimumCost(const std::complex<double>* matr_circ, EqualityComputer& equality_computer, const std::vector<int>& targets) {
+    packCircuit(matr_circ);
+    double best_cost = INFINITY;
+    for (int t : targets) {
+        std::complex<double> conj(weights.row(t).dot(packed_real), weights.row(t).dot(packed_imag));
+        double circ_size = cover_masks.row(cover_group[t]).dot(squared_circ);
+        best_cost = std::min(best_cost, equality_computer.costFromSums(squared_norms[t], normalization_csts[t], circ_size, conj));
+    }
+    return best_cost;
+}
+
+/**
+ * @brief Returns the number of packed targets.
+ *
+ * @return The number of targets.
+ */
+int PackedTargets::nTargets() {
+    return cover_group.size();
+}
+
+/**
+ * @brief Returns the number of entries covered by at least one target.
+ *
+ * @return The number of entries.
+ */
+int PackedTargets::nEntries() {
+    return entries.size();
+}
@@ -0,0 +1,34 @@
+#ifndef DEF_PACKED_TARGETS
+#define DEF_PACKED_TARGETS
+#include <vector>
+#include <memory>
+#include <complex>
+#include <unordered_map>
+#include <Eigen/Dense>
+#include "partialMatrix.h"
+#include "cost.h"
+
+typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> RowMatrixXd;
+
+class PackedTargets {
+    // read-only after construction, the scratch space of the sums is kept per thread
+    public:
+        PackedTargets(std::vector<std::shared_ptr<PartialMatrix>>& targets);
+        double minimumCost(const std::complex<double>* matr_circ, EqualityComputer& equality_computer);
+        double minimumCost(const std::complex<double>* matr_circ, EqualityComputer& equality_computer, const std::vector<int>& targets);
+        void costs(const std::complex<double>* matr_circ, EqualityComputer& equality_computer, std::vector<double>& costs);
+        int nTargets();
+        int nEntries();
+
+    private:
+        void packCircuit(const std::complex<double>* matr_circ);
+
+        std::vector<int> entries; // covered entries of at least one target, in column-major order
+        RowMatrixXd weights; // row t holds the real parts and then the imaginary parts of target t on the entries, zero if not covered
+        RowMatrixXd cover_masks; // row g is 1 on the entries covered by the targets of group g
+        std::vector<int> cover_group; // group of the cover of each target
+        std::vector<double> squared_norms;
+        std::vector<double> normalization_csts;
+};
+
+#endif
@@ -1,6 +1,7 @@
 #include "partialMatrix.h"
 #include "circuit.h"
 #include "utils.h"
+#include "packed_targets.h"
 #include <sstream>
 #include <string>
 
@@ -201,13 +202,13 @@ QubitIndependentPartialMatrix::QubitIndependentPartialMatrix(std::string filenam
  * @brief Copy constructor for QubitIndependentPartialMatrix.
  * 
  * This constructor creates a new QubitIndependentPartialMatrix object by copying the contents of another QubitIndependentPartialMatrix object.
+ * The permuted matrices are not modified after construction, so they are shared with the other object instead of being recalculated.
  * 
  * @param other The QubitIndependentPartialMatrix object to be copied.
  */
 QubitIndependentPartialMatrix::QubitIndependentPartialMatrix(QubitIndependentPartialMatrix const& other) : 
-        use_inverse(other.use_inverse), use_independent_qbs(other.use_independent_qbs) {
-    original = PartialMatrix(other.original);
-    calculateQubitIndependent();
+        use_inverse(other.use_inverse), use_independent_qbs(other.use_independent_qbs), original(other.original), matrices(other.matrices),
+        qbs_info(other.qbs_info), inverse_info(other.inverse_info), packed_targets(other.packed_targets), matrix_index(other.matrix_index) {
 }
 
 /**
@@ -226,13 +227,37 @@ QubitIndependentPartialMatrix::QubitIndependentPartialMatrix(GateCircuit& circui
 }
 
 /**
- * Adds a PartialMatrix to the QubitIndependentPartialMatrix.
+ * Hashes the cover of a PartialMatrix and its covered entries rounded to 1e-4. Matrices that addMatrix considers equal almost always have
+ * the same hash; if rounding separates two of them, both are kept, which only adds a duplicate target.
+ * 
+ * @param matrix The PartialMatrix to hash.
+ * @return The hash.
+ */
+size_t QubitIndependentPartialMatrix::matrixHash(PartialMatrix& matrix) {
+    size_t hash = matrix.cover.size();
+    const bool* cover = matrix.cover.data();
+    const std::complex<double>* entries = matrix.matrix.data();
+    for (int index = 0; index < matrix.cover.size(); index++) {
+        long long real = cover[index] ? std::llround(entries[index].real() * 1e4) : 0;
+        long long imag = cover[index] ? std::llround(entries[index].imag() * 1e4) : 0;
+        for (long long value : {(long long) cover[index], real, imag}) {
+            hash ^= std::hash<long long>()(value) + 0x9e3779b97f4a7c15 + (hash << 6) + (hash >> 2);
+        }
+    }
+    return hash;
+}
+
+/**
+ * Checks whether a PartialMatrix can be added to the QubitIndependentPartialMatrix, which is the case if it is not already one of the matrices.
+ * Only the matrices with the same hash are compared.
  * 
  * @param matrix The PartialMatrix to be added.
- * @return True if the matrix was successfully added, false otherwise.
+ * @return True if the matrix can be added, false otherwise.
  */
 bool QubitIndependentPartialMatrix::addMatrix(PartialMatrix& matrix) {
-    for (std::shared_ptr<PartialMatrix> matr : matrices) {
+    auto candidates = matrix_index.equal_range(matrixHash(matrix));
+    for (auto candidate = candidates.first; candidate != candidates.second; candidate++) {
+        std::shared_ptr<PartialMatrix>& matr = matrices[candidate->second];
         if ((matr->matrix - matrix.matrix).norm() < 1e-6 && (matr->cover.array() != matrix.cover.array()).count() == 0) {
             return false;
         }
@@ -246,11 +271,15 @@ bool QubitIndependentPartialMatrix::addMatrix(PartialMatrix& matrix) {
  * The generated partial matrices are added to the matrices vector if they meet certain conditions.
  * If use_independent_qbs is true, the partial matrices are added regardless of the size of the matrices vector.
  * If use_inverse is true, the inverse of each generated partial matrix is also added to the matrices vector.
+ * The matrices are then packed for computing their equality costs, see getPackedTargets.
  */
 void QubitIndependentPartialMatrix::calculateQubitIndependent() {
     std::vector<int> qbs = {};
     qbs_info = {};
+    inverse_info = {};
     matrices = {};
+    matrix_index.clear();
+    packed_targets = nullptr;
     for (int i = 0; i < original.getNQubits(); i++) {
         qbs.push_back(i);
     }
@@ -271,23 +300,29 @@ void QubitIndependentPartialMatrix::calculateQubitIndependent() {
         }
         PartialMatrix matr = PartialMatrix(new_new_matrix, new_new_cover);
         
-        if (addMatrix(matr) && (use_independent_qbs || matrices.size() == 0)) {
+        if ((use_independent_qbs || matrices.size() == 0) && addMatrix(matr)) {
             std::shared_ptr<PartialMatrix> ptr_matr = std::make_shared<PartialMatrix>(matr);
+            matrix_index.emplace(matrixHash(matr), matrices.size());
             matrices.push_back(ptr_matr);
             qbs_info.push_back(qbs);
             inverse_info.push_back(false);
         }
+        if (!use_inverse) {
+            continue;
+        }
         Eigen::MatrixXcd inverse_matr = new_new_matrix.conjugate();
         BoolMatrix inverse_cover = new_new_cover.transpose();
         PartialMatrix matr2 = PartialMatrix(inverse_matr, inverse_cover);
-        if (addMatrix(matr2) && use_inverse) {
+        if (addMatrix(matr2)) {
             std::shared_ptr<PartialMatrix> ptr_matr2 = std::make_shared<PartialMatrix>(matr2);
+            matrix_index.emplace(matrixHash(matr2), matrices.size());
             matrices.push_back(ptr_matr2);
             qbs_info.push_back(qbs);
             inverse_info.push_back(true);
         }
-        
+
     } while (std::next_permutation(qbs.begin(), qbs.end()));
+    packed_targets = std::make_shared<PackedTargets>(matrices);
 }
 
 /**
@@ -299,11 +334,59 @@ int QubitIndependentPartialMatrix::getNQubits() {
     return original.n_qubits;
 };
 
+/**
+ * Returns the matrices packed for computing their equality costs in a single pass, see PackedTargets.
+ * They are built together with the matrices, so that calling this function from several threads is safe.
+ *
+ * @return A shared pointer to the packed matrices.
+ */
+std::shared_ptr<PackedTargets> QubitIndependentPartialMatrix::getPackedTargets() {
+    if (packed_targets == nullptr) {
+        packed_targets = std::make_shared<PackedTargets>(matrices);
+    }
+    return packed_targets;
+}
+
+/**
+ * Returns the columns covered by at least one of the matrices.
+ *
+ * @param all_matrices Whether all the qubit independent matrices are considered, or only the original one.
+ * @return The covered columns, in increasing order.
+ */
+std::vector<int> QubitIndependentPartialMatrix::coveredColumns(bool all_matrices) {
+    std::vector<int> columns = {};
+    for (int j = 0; j < original.cover.cols(); j++) {
+        bool covered = original.cover.col(j).any();
+        for (int i = 0; i < matrices.size() && all_matrices && !covered; i++) {
+            covered = matrices[i]->cover.col(j).any();
+        }
+        if (covered) {
+            columns.push_back(j);
+        }
+    }
+    return columns;
+}
+
 /**
  * @brief Clones the QubitIndependentPartialMatrix object.
  * 
  * @return A shared pointer to the cloned QubitIndependentPartialMatrix object.
  */
 std::shared_ptr<QubitIndependentPartialMatrix> QubitIndependentPartialMatrix::clone() {
-    return std::make_shared<QubitIndependentPartialMatrix>(QubitIndependentPartialMatrix(original, use_independent_qbs, use_inverse));
-}
\ No newline at end of file
+    return std::make_shared<QubitIndependentPartialMatrix>(*this);
+}
+
+/**
+ * @brief Copies the QubitIndependentPartialMatrix object without sharing any memory with it: unlike clone, the permuted matrices and their
+ * packing are copied too. The copy is allocated by the calling thread, and is thus in the memory of the NUMA node of that thread.
+ *
+ * @return A shared pointer to the copy.
+ */
+std::shared_ptr<QubitIndependentPartialMatrix> QubitIndependentPartialMatrix::replicate() {
+    std::shared_ptr<QubitIndependentPartialMatrix> copy = std::make_shared<QubitIndependentPartialMatrix>(*this);
+    for (std::shared_ptr<PartialMatrix>& matrix : copy->matrices) {
+        matrix = std::make_shared<PartialMatrix>(*matrix);
+    }
+    copy->packed_targets = std::make_shared<PackedTargets>(copy->matrices);
+    return copy;
+}
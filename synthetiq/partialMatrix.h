@@ -1,11 +1,14 @@
 #ifndef DEF_PARTIAL
 #define DEF_PARTIAL
 #include <vector>
+#include <unordered_map>
 #include <Eigen/Dense>
 #include "circuit.h"
 
 typedef Eigen::Matrix<bool, Eigen::Dynamic, Eigen::Dynamic> BoolMatrix;
 
+class PackedTargets;
+
 class BaseConstraint {
     public:
         BaseConstraint();
@@ -40,6 +43,7 @@ class PartialMatrix : public BaseConstraint {
 };
 
 class QubitIndependentPartialMatrix {
+    // read-only after construction, so that one object can be shared by all threads and runs
     public:
         QubitIndependentPartialMatrix (PartialMatrix& matrix, bool use_independent_qbs=true, bool use_inverse=false);
         QubitIndependentPartialMatrix() {};
@@ -49,8 +53,11 @@ class QubitIndependentPartialMatrix {
         QubitIndependentPartialMatrix(Eigen::MatrixXcd matrix, BoolMatrix cover, std::string name="matrix", bool use_independent_qbs=true, bool use_inverse=false);
         void calculateQubitIndependent();
         int getNQubits();
+        std::vector<int> coveredColumns(bool all_matrices=true);
+        std::shared_ptr<PackedTargets> getPackedTargets();
         bool addMatrix(PartialMatrix& matrix);
         std::shared_ptr<QubitIndependentPartialMatrix> clone();
+        std::shared_ptr<QubitIndependentPartialMatrix> replicate();
 
         PartialMatrix original;
         std::vector<std::shared_ptr<PartialMatrix>> matrices;
@@ -58,6 +65,11 @@ class QubitIndependentPartialMatrix {
         std::vector<bool> inverse_info;
         bool use_inverse;
         bool use_independent_qbs;
+    private:
+        static size_t matrixHash(PartialMatrix& matrix);
+
+        std::shared_ptr<PackedTargets> packed_targets; // built with matrices
+        std::unordered_multimap<size_t, int> matrix_index; // indices in matrices by matrixHash
 };
 
 #endif
\ No newline at end of file
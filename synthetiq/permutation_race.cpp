@@ -0,0 +1,94 @@
+#include "permutation_race.h"
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+
+/**
+ * Constructor for the PermutationRace class. Of the permuted targets of a qubit independent matrix, the chain usually only stays close to
+ * a few. The race keeps the targets that were closest to the circuit at the last scan as leaders and evaluates only those at every step.
+ * All targets are scanned again after a fixed number of steps, or earlier when the cost of the chain did not improve for a while,
+ * so that a target that became closer replaces a leader.
+ */
+PermutationRace::PermutationRace() {
+
+}
+
+/**
+ * @brief Constructs a PermutationRace over the given number of targets, with about the square root of that many leaders.
+ *
+ * @param n_targets The number of targets.
+ * @param rescan_interval The number of steps after which all targets are scanned again.
+ * @param stall_steps The number of steps without improvement of the cost after which all targets are scanned again.
+ */
+PermutationRace::PermutationRace(int n_targets, int rescan_interval, int stall_steps): rescan_interval(std::max(rescan_interval, 1)), stall_steps(std::max(stall_steps, 1)) {
+    n_leaders = std::min(n_targets, std::max(2, (int) std::ceil(std::sqrt(n_targets))));
+    order = std::vector<int>(n_targets);
+}
+
+/**
+ * Calculates the cost of the circuit for all targets and keeps the closest ones as leaders. The first leader is the target returned
+ * by MCMC_Sa::calculateClosestMatrix.
+ *
+ * @param circ The gate circuit.
+ * @param matrix_obj The qubit independent partial matrix object.
+ * @param equality_computer The equality computer of the chain.
+ */
+void PermutationRace::rescan(GateCircuit& circ, QubitIndependentPartialMatrix& matrix_obj, EqualityComputer& equality_computer) {
+    equality_computer.normalizedEqualityCosts(circ, matrix_obj, costs);
+    std::iota(order.begin(), order.end(), 0);
+    std::partial_sort(order.begin(), order.begin() + n_leaders, order.end(), [this](int a, int b) {
+        return costs[a] < costs[b] || (costs[a] == costs[b] && a < b);
+    });
+    leaders.assign(order.begin(), order.begin() + n_leaders);
+    steps_since_rescan = 0;
+    steps_since_improvement = 0;
+    best_since_rescan = costs[leaders[0]];
+    n_rescans++;
+}
+
+/**
+ * @brief Calculates the equality cost of the circuit as the minimum over the leaders.
+ *
+ * @param circ The gate circuit.
+ * @param matrix_obj The qubit independent partial matrix object.
+ * @param equality_computer The equality computer of the chain.
+ * @return The equality cost, at least the cost over all targets.
+ */
+double PermutationRace::cost(GateCircuit& circ, QubitIndependentPartialMatrix& matrix_obj, EqualityComputer& equality_computer) {
+    return equality_computer.normalizedEqualityCost(circ, matrix_obj, leaders);
+}
+
+/**
+ * Records a step of the chain.
+ *
+ * @param cur_cost The equality cost of the current circuit after the step.
+ * @return True if all targets should be scanned again.
+ */
+bool PermutationRace::step(double cur_cost) {
+    steps_since_rescan++;
+    if (cur_cost < best_since_rescan) {
+        best_since_rescan = cur_cost;
+        steps_since_improvement = 0;
+    } else {
+        steps_since_improvement++;
+    }
+    return steps_since_rescan >= rescan_interval || steps_since_improvement >= stall_steps;
+}
+
+/**
+ * @brief Returns the current leaders.
+ *
+ * @return The indices of the leaders in matrix_obj.matrices, the closest target at the last scan first.
+ */
+const std::vector<int>& PermutationRace::getLeaders() {
+    return leaders;
+}
+
+/**
+ * @brief Returns the number of scans of all targets so far.
+ *
+ * @return The number of scans.
+ */
+int PermutationRace::getRescans() {
+    return n_rescans;
+}
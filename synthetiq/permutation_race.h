@@ -0,0 +1,34 @@
+#ifndef DEF_PERMUTATION_RACE
+#define DEF_PERMUTATION_RACE
+#include <vector>
+#include <cmath>
+#include "circuit.h"
+#include "cost.h"
+#include "partialMatrix.h"
+
+class PermutationRace {
+    // usage: call rescan on the initial circuit, then cost for every candidate and step once per step of the chain.
+    // When step returns true, call rescan on the current circuit, which changes the cost of the current circuit.
+    public:
+        PermutationRace();
+        PermutationRace(int n_targets, int rescan_interval, int stall_steps);
+        void rescan(GateCircuit& circ, QubitIndependentPartialMatrix& matrix_obj, EqualityComputer& equality_computer);
+        double cost(GateCircuit& circ, QubitIndependentPartialMatrix& matrix_obj, EqualityComputer& equality_computer);
+        bool step(double cur_cost);
+        const std::vector<int>& getLeaders();
+        int getRescans();
+
+    private:
+        int n_leaders = 1;
+        int rescan_interval = 1;
+        int stall_steps = 1;
+        int steps_since_rescan = 0;
+        int steps_since_improvement = 0;
+        int n_rescans = 0;
+        double best_since_rescan = INFINITY;
+        std::vector<int> leaders; // indices in matrix_obj.matrices, the closest target first
+        std::vector<double> costs;
+        std::vector<int> order;
+};
+
+#endif
@@ -17,15 +17,16 @@ RandomCircuitGen::RandomCircuitGen(RandomHelper& random_helper, double id_prob,
  * @param nb_qbs The number of qubits in the circuit.
  * @param ch The CircuitHelper object used for resynthesis.
  * @param mutator The Mutator object used for mutating the circuit.
+ * @param matrix_computer_type The type of MatrixComputer used by the circuit.
  * @return A random GateCircuit object.
  */
-GateCircuit RandomCircuitGen::randomGateCircuit(int nb_gates, int nb_qbs, CircuitHelper& ch, Mutator& mutator){
+GateCircuit RandomCircuitGen::randomGateCircuit(int nb_gates, int nb_qbs, CircuitHelper& ch, Mutator& mutator, MatrixComputerType matrix_computer_type){
     int size = nb_gates;
-    GateCircuit res(size, nb_qbs, ch);
+    GateCircuit res(size, nb_qbs, ch, matrix_computer_type);
     for(int g = 0; g < size; g++){
         res.mutate(random_helper, g, 1.0, id_prob, 0.5);
         if (ensure_non_id) {
-            while (res.getGates()[g]->name == ch.id_gate->name) {
+            while (res.isIdentityAt(g)) {
                 res.mutate(random_helper, g, 1.0, id_prob, 0.5);
             }
         }
@@ -41,9 +42,46 @@ GateCircuit RandomCircuitGen::randomGateCircuit(int nb_gates, int nb_qbs, Circui
  * @param nb_qbs The number of qubits in the circuit.
  * @param ch The CircuitHelper object used for circuit generation.
  * @param mutator The Mutator object used for circuit mutation.
+ * @param matrix_computer_type The type of MatrixComputer used by the circuit.
  * @return The generated gate circuit.
  */
-GateCircuit RandomCircuitGen::randomGateCircuit(int min_nb_gates, int max_nb_gates, int nb_qbs, CircuitHelper& ch, Mutator& mutator){
+GateCircuit RandomCircuitGen::randomGateCircuit(int min_nb_gates, int max_nb_gates, int nb_qbs, CircuitHelper& ch, Mutator& mutator, MatrixComputerType matrix_computer_type){
     int size = min_nb_gates + random_helper.randomInt(max_nb_gates - min_nb_gates);
-    return randomGateCircuit(size, nb_qbs, ch, mutator);
+    return randomGateCircuit(size, nb_qbs, ch, mutator, matrix_computer_type);
+}
+
+/**
+ * Generates a circuit close to an elite circuit: a random window of the elite gates is cut, the remaining gates are spread in order among
+ * identities over the circuit, so that the search has room to insert gates anywhere, and some of them are replaced by random gates.
+ *
+ * @param elite The non-identity gates of the elite circuit.
+ * @param nb_gates The number of gates in the circuit, increased if needed to hold the remaining elite gates.
+ * @param nb_qbs The number of qubits in the circuit.
+ * @param ch The CircuitHelper object used for circuit generation.
+ * @param mutator The mutator of the search, whose gate distribution draws the random gates.
+ * @param strength The fraction of the elite gates cut at most, and the probability of replacing each remaining gate.
+ * @param matrix_computer_type The type of MatrixComputer used by the circuit.
+ * @return The generated gate circuit.
+ */
+GateCircuit RandomCircuitGen::perturbedGateCircuit(const std::vector<GateId>& elite, int nb_gates, int nb_qbs, CircuitHelper& ch, Mutator& mutator, double strength, MatrixComputerType matrix_computer_type){
+    int n_cut = random_helper.randomInt(strength * elite.size() + 1);
+    int cut_start = random_helper.randomInt(elite.size() - n_cut + 1);
+    std::vector<GateId> kept(elite.begin(), elite.begin() + cut_start);
+    kept.insert(kept.end(), elite.begin() + cut_start + n_cut, elite.end());
+
+    int size = std::max(nb_gates, (int) kept.size());
+    GateCircuit res(size, nb_qbs, ch, matrix_computer_type);
+    int next = 0;
+    for (int g = 0; g < size; g++) {
+        // each remaining slot gets the next elite gate with the probability that keeps the gates uniformly spread
+        if (next < kept.size() && random_helper.randomInt(size - g) < kept.size() - next) {
+            if (random_helper.random01() < strength) {
+                mutator.mutate_at_pos(res, g, random_helper);
+            } else {
+                res.placeGateAt(g, kept[next]);
+            }
+            next++;
+        }
+    }
+    return res;
 }
\ No newline at end of file
@@ -8,8 +8,9 @@
 class RandomCircuitGen{
     public:
         RandomCircuitGen(RandomHelper& random_helper, double id_prob = 0.7, bool ensure_non_id = false);
-        GateCircuit randomGateCircuit(int nb_gates, int nb_qbs, CircuitHelper& ch, Mutator& mutator);
-        GateCircuit randomGateCircuit(int min_nb_gates, int max_nb_gates, int nb_qbs, CircuitHelper& ch, Mutator& mutator);
+        GateCircuit randomGateCircuit(int nb_gates, int nb_qbs, CircuitHelper& ch, Mutator& mutator, MatrixComputerType matrix_computer_type=Binary);
+        GateCircuit randomGateCircuit(int min_nb_gates, int max_nb_gates, int nb_qbs, CircuitHelper& ch, Mutator& mutator, MatrixComputerType matrix_computer_type=Binary);
+        GateCircuit perturbedGateCircuit(const std::vector<GateId>& elite, int nb_gates, int nb_qbs, CircuitHelper& ch, Mutator& mutator, double strength, MatrixComputerType matrix_computer_type=Binary);
 
     private:
         RandomHelper& random_helper;
@@ -0,0 +1,321 @@
+#include "result_store.h"
+#include "compiled_gates.h"
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+/**
+ * @brief Constructs a ResultStore for a target and a gate set, without reading its file.
+ *
+ * @param folder The folder of the store, created if it does not exist.
+ * @param matrix The target, with its permutations if they are enabled.
+ * @param gate_folders The gate folders of the gate set.
+ * @param capacity The maximum number of circuits kept for the target.
+ */
+ResultStore::ResultStore(std::string folder, QubitIndependentPartialMatrix& matrix, const std::vector<std::string>& gate_folders, int capacity) : capacity(capacity) {
+    std::filesystem::create_directories(folder);
+    std::ostringstream name;
+    name << std::hex << std::setw(16) << std::setfill('0') << targetKey(matrix, gate_folders) << ".txt";
+    path = (std::filesystem::path(folder) / name.str()).string();
+}
+
+/**
+ * Hashes a partial matrix up to global phase: the entries are divided by the phase of the first covered entry that is not zero, and rounded
+ * to 1e-6 before being hashed with the cover.
+ *
+ * @param matrix The partial matrix.
+ * @return The hash.
+ */
+uint64_t ResultStore::canonicalHash(PartialMatrix& matrix) {
+    uint64_t hash = 0xcbf29ce484222325;
+    int64_t rows = matrix.matrix.rows();
+    int64_t cols = matrix.matrix.cols();
+    hashBytes(hash, &rows, sizeof(rows));
+    hashBytes(hash, &cols, sizeof(cols));
+    std::complex<double> phase = 0;
+    for (int col = 0; col < cols; col++) {
+        for (int row = 0; row < rows; row++) {
+            bool covered = matrix.cover(row, col);
+            hashBytes(hash, &covered, sizeof(covered));
+            if (!covered) {
+                continue;
+            }
+            std::complex<double> value = matrix.matrix(row, col);
+            if (phase == 0.0 && std::abs(value) > 1e-6) {
+                phase = std::conj(value) / std::abs(value);
+            }
+            value *= phase;
+            int64_t rounded[2] = {std::llround(value.real() * 1e6), std::llround(value.imag() * 1e6)};
+            hashBytes(hash, rounded, sizeof(rounded));
+        }
+    }
+    return hash;
+}
+
+/**
+ * Calculates the key of the results of a target and a gate set. If the target has permutations, the key is the smallest hash among them, so that
+ * the targets that only differ by a permutation of their qubits share their results.
+ *
+ * @param matrix The target, with its permutations if they are enabled.
+ * @param gate_folders The gate folders of the gate set.
+ * @return The key.
+ */
+uint64_t ResultStore::targetKey(QubitIndependentPartialMatrix& matrix, const std::vector<std::string>& gate_folders) {
+    uint64_t target_hash = canonicalHash(matrix.original);
+    for (std::shared_ptr<PartialMatrix>& permuted : matrix.matrices) {
+        target_hash = std::min(target_hash, canonicalHash(*permuted));
+    }
+    uint64_t hash = 0xcbf29ce484222325;
+    uint64_t gates_key = compiledGatesKey(matrix.getNQubits(), gate_folders);
+    hashBytes(hash, &result_store_version, sizeof(result_store_version));
+    hashBytes(hash, &matrix.use_independent_qbs, sizeof(matrix.use_independent_qbs));
+    hashBytes(hash, &target_hash, sizeof(target_hash));
+    hashBytes(hash, &gates_key, sizeof(gates_key));
+    return hash;
+}
+
+/**
+ * @brief Returns the path of the file of the store.
+ *
+ * @return The path.
+ */
+std::string ResultStore::getPath() {
+    return path;
+}
+
+/**
+ * @brief Ranks stored circuits by cost, and then by T-count and T-depth.
+ *
+ * @param a The first circuit.
+ * @param b The second circuit.
+ * @return True if a ranks before b.
+ */
+bool ResultStore::better(const StoredCircuit& a, const StoredCircuit& b) {
+    if (a.cost != b.cost) {
+        return a.cost < b.cost;
+    }
+    if (a.tcount != b.tcount) {
+        return a.tcount < b.tcount;
+    }
+    return a.tdepth < b.tdepth;
+}
+
+/**
+ * @brief Reads the file of the store.
+ *
+ * @param read_circuits Set to the circuits of the file.
+ * @param min_gates Set to the minimum number of start gates of the gate scheme, -1 if unknown.
+ * @param max_gates Set to the maximum number of start gates of the gate scheme, -1 if unknown.
+ * @param best_gates Set to the best number of gates of the gate scheme, -1 if unknown.
+ * @return False if the file does not exist or is malformed.
+ */
+bool ResultStore::readFile(std::vector<StoredCircuit>& read_circuits, int& min_gates, int& max_gates, int& best_gates) {
+    read_circuits.clear();
+    min_gates = -1;
+    max_gates = -1;
+    best_gates = -1;
+    std::ifstream file(path, std::ios::binary);
+    std::string line;
+    if (!std::getline(file, line) || line != "synthetiq-store " + std::to_string(result_store_version)) {
+        return false;
+    }
+    while (std::getline(file, line)) {
+        std::istringstream fields(line);
+        std::string keyword;
+        fields >> keyword;
+        if (keyword == "scheme") {
+            fields >> min_gates >> max_gates >> best_gates;
+        } else if (keyword == "circuit") {
+            StoredCircuit circuit;
+            size_t n_bytes;
+            fields >> circuit.tcount >> circuit.tdepth >> circuit.gatecount >> circuit.scheme_gates >> circuit.cost >> n_bytes;
+            circuit.qasm = std::string(n_bytes, '\0');
+            if (fields.fail() || !file.read(&circuit.qasm[0], n_bytes)) {
+                return false;
+            }
+            read_circuits.push_back(circuit);
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Reads the circuits and the gate scheme bounds of the target from the file of the store.
+ *
+ * @return False if the store has no results for the target yet.
+ */
+bool ResultStore::load() {
+    std::vector<StoredCircuit> read_circuits;
+    int min_gates, max_gates, best_gates;
+    if (!readFile(read_circuits, min_gates, max_gates, best_gates)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    for (StoredCircuit& circuit : read_circuits) {
+        merge(circuit);
+    }
+    if (best_gates > 0 && (scheme_best_gates < 0 || best_gates < scheme_best_gates)) {
+        scheme_min_gates = min_gates;
+        scheme_max_gates = max_gates;
+        scheme_best_gates = best_gates;
+    }
+    return true;
+}
+
+/**
+ * @brief Adds a circuit to the circuits in memory, unless it is already there or worse than all of them when they are at capacity.
+ *
+ * @param circuit The circuit.
+ */
+void ResultStore::merge(const StoredCircuit& circuit) {
+    if (circuits.size() >= capacity && !better(circuit, circuits.back())) {
+        return;
+    }
+    for (StoredCircuit& other : circuits) {
+        if (other.qasm == circuit.qasm) {
+            return;
+        }
+    }
+    int position = circuits.size();
+    while (position > 0 && better(circuit, circuits[position - 1])) {
+        position--;
+    }
+    circuits.insert(circuits.begin() + position, circuit);
+    if (circuits.size() > capacity) {
+        circuits.pop_back();
+    }
+}
+
+/**
+ * @brief Records a found circuit, which is written to the file on the next save. Can be called by several threads.
+ *
+ * @param circuit The found circuit.
+ */
+void ResultStore::record(const StoredCircuit& circuit) {
+    std::lock_guard<std::mutex> lock(mutex);
+    merge(circuit);
+}
+
+/**
+ * @brief Records the bounds the gate scheme has learned, kept if they are better than the ones of the store.
+ *
+ * @param min_gates The minimum number of start gates.
+ * @param max_gates The maximum number of start gates.
+ * @param best_gates The best number of gates found.
+ */
+void ResultStore::setGateScheme(int min_gates, int max_gates, int best_gates) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (best_gates > 0 && (scheme_best_gates < 0 || best_gates < scheme_best_gates)) {
+        scheme_min_gates = min_gates;
+        scheme_max_gates = max_gates;
+        scheme_best_gates = best_gates;
+    }
+}
+
+/**
+ * @brief Merges the recorded circuits with the file of the store and replaces it. The file is locked during the merge, so that the circuits
+ * written by another invocation since the load are kept.
+ *
+ * @return False if the file cannot be written.
+ */
+bool ResultStore::save() {
+    int lock_fd = open((path + ".lock").c_str(), O_RDWR | O_CREAT, 0644);
+    if (lock_fd < 0 || flock(lock_fd, LOCK_EX) != 0) {
+        if (lock_fd >= 0) {
+            close(lock_fd);
+        }
+        return false;
+    }
+    load();
+    std::string tmp_path = path + ".tmp." + std::to_string(getpid());
+    std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        file << "synthetiq-store " << result_store_version << "\n";
+        if (scheme_best_gates > 0) {
+            file << "scheme " << scheme_min_gates << " " << scheme_max_gates << " " << scheme_best_gates << "\n";
+        }
+        file.precision(17);
+        for (StoredCircuit& circuit : circuits) {
+            file << "circuit " << circuit.tcount << " " << circuit.tdepth << " " << circuit.gatecount << " " << circuit.scheme_gates << " "
+                 << circuit.cost << " " << circuit.qasm.size() << "\n" << circuit.qasm;
+        }
+    }
+    file.close();
+    bool written = !file.fail() && std::rename(tmp_path.c_str(), path.c_str()) == 0;
+    if (!written) {
+        std::remove(tmp_path.c_str());
+    }
+    flock(lock_fd, LOCK_UN);
+    close(lock_fd);
+    return written;
+}
+
+/**
+ * @brief Rebuilds a stored circuit and checks it against the target, see readCircuit.
+ *
+ * @param stored The stored circuit.
+ * @param matrix The target, with its permutations if they are enabled.
+ * @param ch The CircuitHelper object of the gate set.
+ * @param exact_comp The equality computer with the tolerance of the search.
+ * @return A shared pointer to the circuit implementing the target, nullptr if the circuit cannot be read or does not implement the target.
+ */
+std::shared_ptr<GateCircuit> ResultStore::restore(const StoredCircuit& stored, QubitIndependentPartialMatrix& matrix, CircuitHelper& ch, ExactEqualityComputer& exact_comp) {
+    return readCircuit(stored.qasm, matrix, ch, exact_comp);
+}
+
+/**
+ * @brief Reads a circuit printed by print_qasm and checks it against the target. A circuit found for a permutation of the target, or for its
+ * inverse, is permuted or inverted to implement the target, as the search does for the circuits it finds. The text may come from another
+ * process, so a circuit on another number of qubits is rejected before its gates are read.
+ *
+ * @param qasm The circuit in qasm.
+ * @param matrix The target, with its permutations if they are enabled.
+ * @param ch The CircuitHelper object of the gate set.
+ * @param exact_comp The equality computer with the tolerance of the search.
+ * @return A shared pointer to the circuit implementing the target, nullptr if the circuit cannot be read or does not implement the target.
+ */
+std::shared_ptr<GateCircuit> ResultStore::readCircuit(const std::string& qasm, QubitIndependentPartialMatrix& matrix, CircuitHelper& ch, ExactEqualityComputer& exact_comp) {
+    // the third line declares the qubits, "qreg q[n];"
+    std::istringstream header(qasm);
+    std::string line;
+    for (int i = 0; i < 3; i++) {
+        std::getline(header, line);
+    }
+    if (line.rfind("qreg", 0) != 0 || line.find("[" + std::to_string(matrix.getNQubits()) + "]") == std::string::npos) {
+        return nullptr;
+    }
+    std::shared_ptr<GateCircuit> circuit = std::make_shared<GateCircuit>(ch);
+    try {
+        std::istringstream stream(qasm);
+        circuit->readFromQasm(stream);
+    } catch (std::exception& e) {
+        return nullptr;
+    }
+    if (circuit->nb_qbs != matrix.getNQubits()) {
+        return nullptr;
+    }
+    int best = -1;
+    double best_cost = 1e-3;
+    for (int i = 0; i < matrix.matrices.size(); i++) {
+        double cost = exact_comp.normalizedEqualityCost(*circuit, *matrix.matrices[i], ch);
+        if (cost < best_cost) {
+            best = i;
+            best_cost = cost;
+        }
+    }
+    if (best < 0) {
+        return nullptr;
+    }
+    if (matrix.inverse_info[best]) {
+        circuit->invert();
+    }
+    circuit->changeQubits(matrix.qbs_info[best]);
+    return circuit;
+}
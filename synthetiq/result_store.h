@@ -0,0 +1,57 @@
+#ifndef DEF_RESULT_STORE
+#define DEF_RESULT_STORE
+
+#include "circuit.h"
+#include "cost.h"
+#include "partialMatrix.h"
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+const uint32_t result_store_version = 1;
+
+class StoredCircuit {
+    public:
+        int tcount = 0;
+        int tdepth = 0;
+        int gatecount = 0;
+        int scheme_gates = 0; // number of gates the gate scheme was updated with, before the expansion of composite gates
+        double cost = 0;
+        std::string qasm;
+};
+
+class ResultStore {
+    // the best circuits found for a target and a gate set over all invocations, in one text file per target in a folder. The file name is a
+    // hash of the target up to global phase, and up to qubit permutations when they are enabled, and of the gate files.
+    // Readers never see a partial file, as a file is replaced by renaming a new one, and writers merge their circuits with the file under
+    // an exclusive lock, so that concurrent invocations on the same target do not lose each other's circuits.
+    public:
+        ResultStore(std::string folder, QubitIndependentPartialMatrix& matrix, const std::vector<std::string>& gate_folders, int capacity=32);
+        static uint64_t targetKey(QubitIndependentPartialMatrix& matrix, const std::vector<std::string>& gate_folders);
+        std::string getPath();
+        bool load();
+        bool save();
+        void record(const StoredCircuit& circuit);
+        void setGateScheme(int min_gates, int max_gates, int best_gates);
+        std::shared_ptr<GateCircuit> restore(const StoredCircuit& stored, QubitIndependentPartialMatrix& matrix, CircuitHelper& ch, ExactEqualityComputer& exact_comp);
+        static std::shared_ptr<GateCircuit> readCircuit(const std::string& qasm, QubitIndependentPartialMatrix& matrix, CircuitHelper& ch, ExactEqualityComputer& exact_comp);
+
+        std::vector<StoredCircuit> circuits; // best first
+        int scheme_min_gates = -1; // learned bounds of the gate scheme, -1 if unknown
+        int scheme_max_gates = -1;
+        int scheme_best_gates = -1;
+
+    private:
+        static uint64_t canonicalHash(PartialMatrix& matrix);
+        static bool better(const StoredCircuit& a, const StoredCircuit& b);
+        bool readFile(std::vector<StoredCircuit>& read_circuits, int& min_gates, int& max_gates, int& best_gates);
+        void merge(const StoredCircuit& circuit);
+
+        std::string path;
+        int capacity;
+        std::mutex mutex;
+};
+
+#endif
@@ -3,17 +3,35 @@
 #include <sstream>
 
 /**
- * Runs the resynthesis algorithm on the given gate circuit.
+ * @brief Sets the cancellation token polled by the resynthesis.
+ * 
+ * @param c A shared pointer to the CancellationToken object, or nullptr for a resynthesis that always runs to completion.
+ */
+void Resynthesize::set_cancellation(std::shared_ptr<CancellationToken> c) {
+    cancellation = c;
+}
+
+/**
+ * Runs the resynthesis algorithm on the given gate circuit. Every change keeps the circuit equivalent, so the resynthesis can stop
+ * once the cancellation token is cancelled and leave a correct, if less optimized, circuit. The token is first polled after
+ * cancellation_poll_steps changes, so that the short resynthesis of a circuit found just before the deadline completes.
  * 
  * @param circuit The gate circuit to be resynthesized.
  * @param ch The CircuitHelper object used for resynthesis.
  * @param second_time Flag indicating if it is the second time running the algorithm.
+ * @return False if the resynthesis was stopped by the cancellation token before it completed.
  */
-void Resynthesize::run(std::shared_ptr<GateCircuit> circuit, CircuitHelper& ch, bool second_time) {
+bool Resynthesize::run(std::shared_ptr<GateCircuit> circuit, CircuitHelper& ch, bool second_time) {
 
     circuit->stopMatrixComputer();
     int gate_index = 0;
+    int n_changes = 0;
+    bool completed = true;
     while(gate_index < circuit->nbElements() - 1) {
+        if ((++n_changes & (cancellation_poll_steps - 1)) == 0 && cancellation && cancellation->poll()) {
+            completed = false;
+            break;
+        }
         int changed = change(circuit, gate_index, ch, second_time);
         if (changed < 0) {
             gate_index += std::max(changed, -gate_index);
@@ -21,12 +39,13 @@ void Resynthesize::run(std::shared_ptr<GateCircuit> circuit, CircuitHelper& ch,
             gate_index += changed;
         }
     }
-    if (!second_time) {
+    if (!second_time && completed) {
         circuit->rotate();
-        run(circuit, ch, true);
+        completed = run(circuit, ch, true);
         circuit->rotate();
     }
     circuit->startMatrixComputer();
+    return completed;
 };
 
 /**
@@ -39,7 +58,7 @@ void Resynthesize::run(std::shared_ptr<GateCircuit> circuit, CircuitHelper& ch,
 int Resynthesize::NbBeforeCommutes(int index, std::shared_ptr<GateCircuit> circuit) {
     int nb_commutes = 0;
     for (int i = index - 1; i >= 0; i--) {
-        if (commutes(circuit->getGates()[index], circuit->getGates()[i])) {
+        if (commutes(circuit->getGate(index), circuit->getGate(i))) {
             nb_commutes += 1;
         }
         else {
@@ -61,8 +80,8 @@ int Resynthesize::NbBeforeCommutes(int index, std::shared_ptr<GateCircuit> circu
  */
 bool Resynthesize::priorityChange(int index, std::shared_ptr<GateCircuit> circuit, bool second_time) {
     if (watch_depth && second_time) {
-        std::shared_ptr<Gate> gate1 = circuit->getGates()[index];
-        std::shared_ptr<Gate> gate2 = circuit->getGates()[index + 1];
+        GateId gate1 = circuit->getGateIds()[index];
+        GateId gate2 = circuit->getGateIds()[index + 1];
         int original_depth = circuit->getDepth(depth_gates);
         circuit->placeGateAt(index, gate2);
         circuit->placeGateAt(index + 1, gate1);
@@ -78,8 +97,8 @@ bool Resynthesize::priorityChange(int index, std::shared_ptr<GateCircuit> circui
     
     int commutes1 = NbBeforeCommutes(index, circuit);
     int commutes2 = NbBeforeCommutes(index + 1, circuit);
-    std::shared_ptr<Gate> gate1 = circuit->getGates()[index];
-    std::shared_ptr<Gate> gate2 = circuit->getGates()[index + 1];
+    const std::shared_ptr<Gate>& gate1 = circuit->getGate(index);
+    const std::shared_ptr<Gate>& gate2 = circuit->getGate(index + 1);
     if (commutes1 < commutes2 - 1) {
         return true;
     } else if (commutes1 > commutes2 - 1) {
@@ -107,12 +126,34 @@ bool Resynthesize::priorityChange(int index, std::shared_ptr<GateCircuit> circui
 /**
  * Checks if two gates commute with each other.
  * 
+ * Gates acting on disjoint qubits and pairs of diagonal gates always commute. Pairs of permutation or monomial gates are compared
+ * by following each basis state through both products. Only the remaining pairs need the full products.
+ * 
  * @param gate1 The first gate.
  * @param gate2 The second gate.
  * @return True if the gates commute, false otherwise.
  */
-bool Resynthesize::commutes(std::shared_ptr<Gate> gate1, std::shared_ptr<Gate> gate2) {
-    return gate1->matrix * gate2->matrix == gate2->matrix * gate1->matrix;
+bool Resynthesize::commutes(const std::shared_ptr<Gate>& gate1, const std::shared_ptr<Gate>& gate2) {
+    if ((gate1->local_mask & gate2->local_mask) == 0) {
+        return true;
+    } else if (gate1->kind == Diagonal && gate2->kind == Diagonal) {
+        return true;
+    } else if (gate1->kind != Dense && gate2->kind != Dense) {
+        for (int col = 0; col < (1 << gate1->nb_qbs); col++) {
+            std::complex<double> phase1, phase2, phase12, phase21;
+            int row12 = gate1->monomialImage(gate2->monomialImage(col, phase2), phase12);
+            int row21 = gate2->monomialImage(gate1->monomialImage(col, phase1), phase21);
+            if (row12 != row21 || std::abs(phase12 * phase2 - phase21 * phase1) > Gate::structure_epsilon) {
+                return false;
+            }
+        }
+        return true;
+    }
+    Eigen::MatrixXcd product12 = gate2->getMatrix();
+    gate1->applyLeft(product12);
+    Eigen::MatrixXcd product21 = gate1->getMatrix();
+    gate2->applyLeft(product21);
+    return product12 == product21;
 };
 
 /**
@@ -129,24 +170,26 @@ bool Resynthesize::commutes(std::shared_ptr<Gate> gate1, std::shared_ptr<Gate> g
  * @return An integer value indicating how many steps to retrace in the circuit before applying the next change.
  */
 int Resynthesize::change(std::shared_ptr<GateCircuit> circuit, int gate_index, CircuitHelper& ch, bool second_time) {
-    std::shared_ptr<Gate> gate1 = circuit->getGates()[gate_index];
-    std::shared_ptr<Gate> gate2 = circuit->getGates()[gate_index + 1];
-    if (gate2->name == ch.id_gate->name) {
+    GateId gate1 = circuit->getGateIds()[gate_index];
+    GateId gate2 = circuit->getGateIds()[gate_index + 1];
+    bool identity1 = circuit->isIdentityAt(gate_index);
+    bool identity2 = circuit->isIdentityAt(gate_index + 1);
+    if (identity2) {
         return 1;
     }
-    Eigen::MatrixXcd mult = gate2->matrix;
-    double cost = gate2->cost;
+    Eigen::MatrixXcd mult = circuit->getGate(gate_index + 1)->getMatrix();
+    double cost = circuit->getGate(gate_index + 1)->cost;
     if (!second_time) {
         for (int n_extra_gates = 0; n_extra_gates < max_gate_mult - 1; n_extra_gates++) {
             if (gate_index - n_extra_gates < 0) {
                 break;
-            } else if (circuit->getGates()[gate_index - n_extra_gates]->name == ch.id_gate->name) {
+            } else if (circuit->isIdentityAt(gate_index - n_extra_gates)) {
                 continue;
             }
-            mult = circuit->getGates()[gate_index - n_extra_gates]->matrix * mult;
-            cost += circuit->getGates()[gate_index - n_extra_gates]->cost;
+            circuit->getGate(gate_index - n_extra_gates)->applyLeft(mult);
+            cost += circuit->getGate(gate_index - n_extra_gates)->cost;
             for (int i = 0; i < ch.all_gates.size(); i++) {
-                if (cost > ch.all_gates[i]->cost && Utils::matricesEqual(mult, ch.all_gates[i]->matrix)) {
+                if (cost > ch.all_gates[i]->cost && ch.all_gates[i]->equalsMatrix(mult)) {
                     circuit->placeGateAt(gate_index - n_extra_gates, ch.all_gates[i]);
                     for (int j = -n_extra_gates + 1; j < 2; j++) {
                         circuit->placeGateAt(gate_index + j, ch.id_gate);
@@ -157,13 +200,13 @@ int Resynthesize::change(std::shared_ptr<GateCircuit> circuit, int gate_index, C
         }
     }
     
-    if (gate1->name == ch.id_gate->name && gate2->name != ch.id_gate->name) {
+    if (identity1 && !identity2) {
         circuit->placeGateAt(gate_index, gate2);
         circuit->placeGateAt(gate_index + 1, gate1);
         return -1;
     }
 
-    if (gate1->name != ch.id_gate->name && gate2->name != ch.id_gate->name && commutes(gate1, gate2)) {
+    if (!identity1 && !identity2 && commutes(circuit->getGate(gate_index), circuit->getGate(gate_index + 1))) {
         if (priorityChange(gate_index, circuit, second_time)) {
             circuit->placeGateAt(gate_index, gate2);
             circuit->placeGateAt(gate_index + 1, gate1);
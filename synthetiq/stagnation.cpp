@@ -0,0 +1,67 @@
+#include "stagnation.h"
+#include <algorithm>
+
+/**
+ * @brief Constructs a StagnationDetector.
+ *
+ * @param window The number of sweeps of the circuit in a window, 0 to disable the detector.
+ * @param improvement The least improvement of the best energy in a window, relative to the temperature at the end of the window.
+ * @param min_acceptance The least fraction of the proposals of a window that are accepted, 0 to not check it.
+ */
+StagnationDetector::StagnationDetector(double window, double improvement, double min_acceptance) :
+        window(window), improvement(improvement), min_acceptance(min_acceptance) {
+}
+
+/**
+ * @brief Starts the first window of a run.
+ *
+ * @param best_energy The energy of the initial circuit.
+ * @param nb_elements The number of gates of the circuit, the length of a sweep.
+ */
+void StagnationDetector::reset(double best_energy, int nb_elements) {
+    window_steps = std::max(1, (int) (window * nb_elements));
+    n_steps = 0;
+    n_accepted = 0;
+    window_best_energy = best_energy;
+    reason = StopStepBudget;
+}
+
+/**
+ * @brief Records a proposal, and checks whether the run has stagnated at the end of a window.
+ *
+ * @param accepted Whether the proposal was accepted.
+ * @param best_energy The best energy of the run so far.
+ * @param temperature The current temperature.
+ * @return True if the run has stagnated and should stop, see getReason.
+ */
+bool StagnationDetector::step(bool accepted, double best_energy, double temperature) {
+    if (window <= 0) {
+        return false;
+    }
+    n_steps++;
+    n_accepted += accepted;
+    if (n_steps < window_steps) {
+        return false;
+    }
+    if (n_accepted < min_acceptance * n_steps) {
+        reason = StopLowAcceptance;
+        return true;
+    }
+    if (window_best_energy - best_energy <= improvement * temperature) {
+        reason = StopNoImprovement;
+        return true;
+    }
+    n_steps = 0;
+    n_accepted = 0;
+    window_best_energy = best_energy;
+    return false;
+}
+
+/**
+ * @brief Returns why the last call to step returned true.
+ *
+ * @return StopNoImprovement or StopLowAcceptance, StopStepBudget if the run has not stagnated.
+ */
+StopReason StagnationDetector::getReason() {
+    return reason;
+}
@@ -0,0 +1,32 @@
+#ifndef DEF_STAGNATION
+#define DEF_STAGNATION
+
+// why an annealing run stopped, see MCMCResult
+enum StopReason {StopStepBudget, StopFound, StopCancelled, StopNoImprovement, StopLowAcceptance};
+const int nbStopReasons = 5;
+const char* const stop_reason_names[nbStopReasons] = {"step budget", "found", "cancelled", "no improvement", "low acceptance"};
+
+class StagnationDetector {
+    // stops annealing runs that no longer make progress. The proposals of a run are split in windows of a number of sweeps of the circuit, and
+    // at the end of a window the run has stagnated if its best energy improved by at most improvement times the temperature during the window,
+    // or if it accepted less than min_acceptance of the proposals of the window. With a window of 0 the detector is disabled, and runs use
+    // their whole step budget.
+    // usage: call reset at the start of a run, then step after every proposal whose energy is computed, and stop the run once it returns true.
+    public:
+        StagnationDetector(double window=0.0, double improvement=0.0, double min_acceptance=0.0);
+        void reset(double best_energy, int nb_elements);
+        bool step(bool accepted, double best_energy, double temperature);
+        StopReason getReason();
+
+    private:
+        double window; // in sweeps of the circuit
+        double improvement; // relative to the temperature
+        double min_acceptance;
+        int window_steps = 0;
+        int n_steps = 0;
+        int n_accepted = 0;
+        double window_best_energy = 0;
+        StopReason reason = StopStepBudget;
+};
+
+#endif